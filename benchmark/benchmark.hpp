@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+// Heap allocations made by the whole program, counted by the replacement
+// operator new family below. The count is atomic, so that it stays exact
+// when the code being measured allocates on threads of its own
+inline std::atomic<std::size_t> allocation_count{0};
+
+// Allocation and release behind every replacement operator. They are kept
+// out of line, so that the compiler doesn't pair the malloc and free with
+// the new and delete expressions and warn about mismatched functions
+[[gnu::noinline]] inline void * counted_allocate(std::size_t size) noexcept {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+[[gnu::noinline]] inline void counted_release(void * pointer) noexcept {
+  std::free(pointer);
+}
+
+void * operator new(std::size_t size) {
+  if (void * pointer = counted_allocate(size))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size) {
+  if (void * pointer = counted_allocate(size))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void * operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_allocate(size);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_allocate(size);
+}
+
+void operator delete(void * pointer) noexcept {
+  counted_release(pointer);
+}
+
+void operator delete[](void * pointer) noexcept {
+  counted_release(pointer);
+}
+
+void operator delete(void * pointer, std::size_t) noexcept {
+  counted_release(pointer);
+}
+
+void operator delete[](void * pointer, std::size_t) noexcept {
+  counted_release(pointer);
+}
+
+void operator delete(void * pointer, const std::nothrow_t&) noexcept {
+  counted_release(pointer);
+}
+
+void operator delete[](void * pointer, const std::nothrow_t&) noexcept {
+  counted_release(pointer);
+}
+
+// Stream buffer that discards its input and only counts the bytes
+class null_buffer : public std::streambuf {
+public:
+  std::size_t bytes = 0;
+
+protected:
+  int_type overflow(int_type value) override {
+    bytes += 1;
+    return traits_type::not_eof(value);
+  }
+
+  std::streamsize xsputn(const char *, std::streamsize count) override {
+    bytes += static_cast<std::size_t>(count);
+    return count;
+  }
+};
+
+// Stream that all benchmarks print to
+inline null_buffer& null_stream_buffer() {
+  static null_buffer buffer;
+  return buffer;
+}
+
+inline std::ostream& null_stream() {
+  static std::ostream stream(&null_stream_buffer());
+  return stream;
+}
+
+// Runs `body` until at least `min_seconds` have elapsed and reports the
+// average time per iteration, the output throughput and the number of
+// heap allocations per iteration
+inline void run_benchmark(const std::string& name, const std::function<void()>& body,
+			  double min_seconds = 0.5) {
+  null_buffer& buffer = null_stream_buffer();
+  body(); // warm up
+
+  using clock = std::chrono::steady_clock;
+  std::size_t iterations = 0;
+  buffer.bytes = 0;
+  const std::size_t allocations = allocation_count.load(std::memory_order_relaxed);
+  const auto start = clock::now();
+  double elapsed = 0;
+  do {
+    body();
+    iterations += 1;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  } while (elapsed < min_seconds);
+
+  const double per_iteration = elapsed / iterations;
+  const double megabytes = static_cast<double>(buffer.bytes) / iterations / (1024.0 * 1024.0);
+  const double allocations_per_iteration = static_cast<double>(allocation_count.load(std::memory_order_relaxed) - allocations) / iterations;
+  std::printf("%-52s %12.4f ms %10.1f MB/s %10.1f allocs\n", name.c_str(), per_iteration * 1e3,
+	      megabytes / per_iteration, allocations_per_iteration);
+}
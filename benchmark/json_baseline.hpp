@@ -0,0 +1,87 @@
+#pragma once
+#include <charconv>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A JSON writer written by hand for the shapes of the benchmark, as a
+// baseline for pprint::JsonPrinter: it appends to a reused string with a
+// byte-by-byte escape loop and std::to_chars, then writes the string out
+class hand_written_json {
+public:
+  explicit hand_written_json(std::ostream& stream) :
+    stream_(stream) {}
+
+  template <typename T>
+  void print(const T& value) {
+    out_.clear();
+    write(value);
+    out_ += '\n';
+    stream_.write(out_.data(), static_cast<std::streamsize>(out_.size()));
+  }
+
+private:
+  void write(int value) {
+    char digits[16];
+    out_.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+  }
+
+  void write(double value) {
+    char digits[32];
+    out_.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+  }
+
+  void write(const std::string& value) {
+    static const char hex_digits[] = "0123456789abcdef";
+    out_ += '"';
+    for (char c : value) {
+      switch (c) {
+      case '"': out_ += "\\\""; break;
+      case '\\': out_ += "\\\\"; break;
+      case '\n': out_ += "\\n"; break;
+      case '\r': out_ += "\\r"; break;
+      case '\t': out_ += "\\t"; break;
+      default:
+	if (static_cast<unsigned char>(c) < 0x20) {
+	  out_ += "\\u00";
+	  out_ += hex_digits[c >> 4];
+	  out_ += hex_digits[c & 0xF];
+	}
+	else {
+	  out_ += c;
+	}
+      }
+    }
+    out_ += '"';
+  }
+
+  template <typename T>
+  void write(const std::vector<T>& values) {
+    out_ += '[';
+    for (size_t i = 0; i < values.size(); i++) {
+      if (i > 0)
+	out_ += ',';
+      write(values[i]);
+    }
+    out_ += ']';
+  }
+
+  template <typename T>
+  void write(const std::map<std::string, T>& values) {
+    out_ += '{';
+    bool first = true;
+    for (const auto& entry : values) {
+      if (!first)
+	out_ += ',';
+      first = false;
+      write(entry.first);
+      out_ += ':';
+      write(entry.second);
+    }
+    out_ += '}';
+  }
+
+  std::ostream& stream_;
+  std::string out_;
+};
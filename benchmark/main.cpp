@@ -0,0 +1,154 @@
+#include <benchmark.hpp>
+#include <json_baseline.hpp>
+#include <pprint.hpp>
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+int main() {
+  std::vector<int> integers(1000000);
+  for (size_t i = 0; i < integers.size(); i++)
+    integers[i] = static_cast<int>(i * 7919 % 1000003);
+
+  std::vector<double> doubles(1000000);
+  for (size_t i = 0; i < doubles.size(); i++)
+    doubles[i] = static_cast<double>(i) / 7.0;
+
+  std::vector<std::array<float, 4>> vertices(250000, std::array<float, 4>{0.25f, -1.5f, 3.0f, 1.0f});
+
+  std::vector<std::vector<int>> nested(10000, std::vector<int>{1, 22, 333, 4444, 55555});
+
+  std::vector<std::string> strings(200000, "pretty printer");
+
+  std::map<std::string, std::vector<std::string>> dictionary;
+  for (int i = 0; i < 20000; i++)
+    dictionary["key" + std::to_string(i)] = {"alpha", "beta", "gamma"};
+
+  std::vector<std::shared_ptr<int>> pointers;
+  for (int i = 0; i < 100000; i++)
+    pointers.push_back(std::make_shared<int>(i));
+
+  std::unordered_map<int, int> table;
+  for (int i = 0; i < 1000000; i++)
+    table[i] = i;
+
+  // Printers are reused across iterations, as a long-lived logger would be
+  pprint::PrettyPrinter printer(null_stream());
+
+  pprint::PrettyPrinter compact(null_stream());
+  compact.compact(true);
+
+  pprint::PrettyPrinter quoted(null_stream());
+  quoted.quotes(true);
+
+  pprint::PrettyPrinter truncated(null_stream());
+  truncated.max_elements(10, 10);
+
+  pprint::PrettyPrinter budgeted(null_stream());
+  budgeted.quotes(true);
+  budgeted.max_bytes(64 * 1024);
+
+  // The same layouts fixed at compile time
+  pprint::BasicPrinter<pprint::StaticPolicy<>> static_printer(null_stream());
+  pprint::BasicPrinter<pprint::StaticPolicy<true>> static_compact(null_stream());
+  pprint::BasicPrinter<pprint::StaticPolicy<false, true>> static_quoted(null_stream());
+
+  run_benchmark("vector<int> (1M)", [&] { printer.print(integers); });
+  run_benchmark("vector<int> (1M, compact)", [&] { compact.print(integers); });
+  run_benchmark("vector<double> (1M)", [&] { printer.print(doubles); });
+  run_benchmark("vector<array<float, 4>> (250k)", [&] { printer.print(vertices); });
+  run_benchmark("vector<vector<int>> (10k x 5)", [&] { printer.print(nested); });
+  run_benchmark("vector<string> (200k, quoted)", [&] { quoted.print(strings); });
+  run_benchmark("map<string, vector<string>> (20k)", [&] { quoted.print(dictionary); });
+  run_benchmark("vector<shared_ptr<int>> (100k)", [&] { printer.print(pointers); });
+  run_benchmark("vector<int> (1M, max_elements(10, 10))", [&] { truncated.print(integers); });
+  run_benchmark("unordered_map<int, int> (1M, max_elements(10))", [&] { truncated.print(table); });
+  run_benchmark("vector<int> (1M, max_bytes(64 KiB))", [&] { budgeted.print(integers); });
+  run_benchmark("map<string, vector<string>> (20k, max_bytes(64 KiB))", [&] { budgeted.print(dictionary); });
+
+  // Large containers formatted in chunks on 1 to N threads
+  std::vector<int> many_integers(10000000);
+  for (size_t i = 0; i < many_integers.size(); i++)
+    many_integers[i] = static_cast<int>(i * 7919 % 1000003);
+  std::vector<double> many_doubles(4000000);
+  for (size_t i = 0; i < many_doubles.size(); i++)
+    many_doubles[i] = static_cast<double>(i) / 7.0;
+  const size_t cores = (std::max)(1u, std::thread::hardware_concurrency());
+  std::vector<size_t> thread_counts;
+  for (size_t threads = 1; threads < cores; threads *= 2)
+    thread_counts.push_back(threads);
+  thread_counts.push_back(cores);
+  for (size_t threads : thread_counts) {
+    pprint::PrettyPrinter parallel(null_stream());
+    parallel.parallel(100000, threads);
+    const std::string suffix = ", " + std::to_string(threads) + (threads == 1 ? " thread)" : " threads)");
+    run_benchmark("vector<int> (10M" + suffix, [&] { parallel.print(many_integers); });
+    run_benchmark("vector<double> (4M" + suffix, [&] { parallel.print(many_doubles); });
+  }
+
+  // Log lines printed directly, and logged as binary records that are
+  // either shipped as a binary log or formatted afterwards
+  pprint::BinaryLogger logger(compact);
+  auto log_lines = [](auto& sink) {
+    for (int i = 0; i < 1000; i++)
+      sink.print("request", i, 0.25 * i, "GET /index.html", std::array<int, 3>{i, i + 1, i + 2});
+  };
+  run_benchmark("log lines (1k)", [&] { log_lines(compact); });
+  run_benchmark("log lines (1k, binary log, write)", [&] {
+    log_lines(logger);
+    logger.write(null_stream());
+  });
+  run_benchmark("log lines (1k, binary log, flush)", [&] {
+    log_lines(logger);
+    logger.flush();
+  });
+
+  // Records of one shape printed as text, and streamed with their
+  // descriptor written once
+  pprint::RecordStream records(null_stream(), compact);
+  std::vector<std::tuple<int, double, std::string>> rows;
+  for (int i = 0; i < 10000; i++)
+    rows.emplace_back(i, i / 7.0, "user" + std::to_string(i));
+  auto print_rows = [&rows](auto& sink) {
+    for (const auto& row : rows)
+      sink.print(row);
+  };
+  run_benchmark("tuple<int, double, string> records (10k)", [&] { print_rows(compact); });
+  run_benchmark("tuple<int, double, string> records (10k, record stream)", [&] {
+    print_rows(records);
+    records.flush();
+  });
+
+  // JSON output, next to a writer written by hand for these shapes
+  pprint::JsonPrinter json(null_stream());
+  hand_written_json baseline(null_stream());
+  run_benchmark("vector<int> (1M, json)", [&] { json.print(integers); });
+  run_benchmark("vector<int> (1M, json, hand-written)", [&] { baseline.print(integers); });
+  run_benchmark("vector<double> (1M, json)", [&] { json.print(doubles); });
+  run_benchmark("vector<double> (1M, json, hand-written)", [&] { baseline.print(doubles); });
+  run_benchmark("vector<string> (200k, json)", [&] { json.print(strings); });
+  run_benchmark("vector<string> (200k, json, hand-written)", [&] { baseline.print(strings); });
+  run_benchmark("map<string, vector<string>> (20k, json)", [&] { json.print(dictionary); });
+  run_benchmark("map<string, vector<string>> (20k, json, hand-written)", [&] { baseline.print(dictionary); });
+
+  pprint::CborPrinter cbor(null_stream());
+  run_benchmark("vector<int> (1M, cbor)", [&] { cbor.print(integers); });
+  run_benchmark("vector<double> (1M, cbor)", [&] { cbor.print(doubles); });
+  run_benchmark("vector<array<float, 4>> (250k, cbor)", [&] { cbor.print(vertices); });
+  run_benchmark("vector<string> (200k, cbor)", [&] { cbor.print(strings); });
+  run_benchmark("map<string, vector<string>> (20k, cbor)", [&] { cbor.print(dictionary); });
+
+  run_benchmark("vector<int> (1M, static)", [&] { static_printer.print(integers); });
+  run_benchmark("vector<int> (1M, compact, static)", [&] { static_compact.print(integers); });
+  run_benchmark("vector<double> (1M, static)", [&] { static_printer.print(doubles); });
+  run_benchmark("vector<array<float, 4>> (250k, static)", [&] { static_printer.print(vertices); });
+  run_benchmark("vector<vector<int>> (10k x 5, static)", [&] { static_printer.print(nested); });
+  run_benchmark("vector<string> (200k, quoted, static)", [&] { static_quoted.print(strings); });
+  run_benchmark("map<string, vector<string>> (20k, static)", [&] { static_quoted.print(dictionary); });
+  run_benchmark("vector<shared_ptr<int>> (100k, static)", [&] { static_printer.print(pointers); });
+}
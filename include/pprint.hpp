@@ -36,6 +36,12 @@ SOFTWARE.
 #include <iostream>
 #include <string>
 #include <typeinfo>
+#include <typeindex>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <new>
 #include <type_traits>
 #include <vector>
 #include <list>
@@ -49,7 +55,9 @@ SOFTWARE.
 #include <variant>
 #include <algorithm>
 #include <cassert>
+#include <exception>
 #include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <limits>
 #include <string_view>
@@ -63,12 +71,24 @@ SOFTWARE.
 #include <complex>
 #include <cmath>
 #include <memory>
+#include <cstring>
+#include <cstdio>
+#include <streambuf>
+#include <charconv>
 #ifdef __GNUG__
 #include <cstdlib>
 #include <memory>
 #include <cxxabi.h>
 #endif
 
+// RTTI is only used to name the dynamic type of polymorphic objects, so
+// pprint also builds with -fno-rtti
+#if defined(__GXX_RTTI) || defined(_CPPRTTI) || defined(__cpp_rtti)
+#  define PPRINT_RTTI 1
+#else
+#  define PPRINT_RTTI 0
+#endif
+
 // Check if a type is stream writable, i.e., std::cout << foo;
 template<typename S, typename T, typename = void>
 struct is_to_stream_writable: std::false_type {};
@@ -78,52 +98,6 @@ struct is_to_stream_writable<S, T,
 			     std::void_t<  decltype( std::declval<S&>()<<std::declval<T>() ) >>
   : std::true_type {};
 
-
-// Printing std::tuple
-// The indices trick: http://loungecpp.wikidot.com/tips-and-tricks:indices 
-namespace pprint {
-  
-  template<std::size_t...> struct seq{};
- 
-  template<std::size_t N, std::size_t... Is>
-  struct gen_seq : gen_seq<N-1, N-1, Is...>{};
- 
-  template<std::size_t... Is>
-  struct gen_seq<0, Is...> : seq<Is...>{};
-
-  template<typename T>
-  T to_string(T value) {
-    return value;
-  }
-
-  std::string to_string(char value) {
-    return "'" + std::string(1, value) + "'";
-  }
-
-  std::string to_string(const char * value) {
-    return "\"" + std::string(value) + "\"";
-  }  
-    
-  std::string to_string(const std::string& value) {
-    return "\"" + value + "\"";
-  }
- 
-  template<class Ch, class Tr, class Tuple, std::size_t... Is>
-  void print_tuple(std::basic_ostream<Ch,Tr>& os, Tuple const& t, seq<Is...>){
-    using swallow = int[];
-    (void)swallow{0, (void(os << (Is == 0? "" : ", ") << to_string(std::get<Is>(t))), 0)...};
-  }
-  
-}
-
-template<class Ch, class Tr, class... Args>
-auto operator<<(std::basic_ostream<Ch, Tr>& os, std::tuple<Args...> const& t)
-  -> std::basic_ostream<Ch, Tr>& {
-  os << "(";
-  pprint::print_tuple(os, t, pprint::gen_seq<sizeof...(Args)>());
-  return os << ")";
-}
-
 // Enum value must be greater or equals than MAGIC_ENUM_RANGE_MIN. By default MAGIC_ENUM_RANGE_MIN = -128.
 // If need another min range for all enum types by default, redefine the macro MAGIC_ENUM_RANGE_MIN.
 #if !defined(MAGIC_ENUM_RANGE_MIN)
@@ -440,752 +414,5092 @@ namespace pprint {
 			      typename T::value_type
 			      >> : std::true_type // will  be enabled for iterable objects
   {};
-  
-  class PrettyPrinter {
-  private:
-    std::ostream& stream_;
-    std::string line_terminator_;
-    size_t indent_;
-    bool quotes_;
-    bool compact_;    
 
-  public:
+  // Representation of float, double and long double values
+  enum class FloatFormat {
+    shortest,   // Fewest digits that read back as the same value (default)
+    general,    // Like %g: `precision` significant digits
+    fixed,      // Like %f: `precision` digits after the decimal point
+    scientific, // Like %e: `precision` digits after the decimal point
+    hex         // Like %a: exact hexadecimal significand and binary exponent
+  };
 
-    PrettyPrinter(std::ostream& stream = std::cout) :
-      stream_(stream),
-      line_terminator_("\n"),
-      indent_(2),
-      compact_(false),
-      quotes_(false) {}
+  namespace detail {
+    inline constexpr std::string_view line_feed = "\n";
+  }
 
-    PrettyPrinter& line_terminator(const std::string& value) {
-      line_terminator_ = value;
-      return *this;
-    }
+  // Layout settings chosen at run time through the printer's setters
+  struct RuntimePolicy {
+    static constexpr bool configurable = true;
+  };
 
-    PrettyPrinter& indent(size_t indent) {
-      indent_ = indent;
-      return *this;
-    }
+  // Layout settings fixed at compile time, so that a printer compiles to
+  // formatting code without branches on them. The line terminator is a
+  // reference to a string_view with static storage duration
+  template <bool Compact = false, bool Quotes = false, size_t Indent = 2,
+	    const std::string_view& LineTerminator = detail::line_feed>
+  struct StaticPolicy {
+    static constexpr bool configurable = false;
+    static constexpr bool compact = Compact;
+    static constexpr bool quotes = Quotes;
+    static constexpr size_t indent = Indent;
+    static constexpr std::string_view line_terminator = LineTerminator;
+  };
 
-    PrettyPrinter& compact(bool value) {
-      compact_ = value;
-      return *this;
+  template <typename Policy>
+  class BasicPrinter;
+
+  typedef BasicPrinter<RuntimePolicy> PrettyPrinter;
+
+  template <typename Policy>
+  class basic_format_context;
+
+  typedef basic_format_context<RuntimePolicy> format_context;
+
+  namespace detail {
+    // Base of the primary formatter template, so that a specialization is
+    // detected without probing for its format member
+    struct default_formatter {};
+  }
+
+  // Customization point for printing a user-defined type. Specializations
+  // provide
+  //
+  //   void format(const T& value, format_context& context) const;
+  //
+  // and take precedence over operator<< and the default "<Object T>" form.
+  // Formatters that are also used with a BasicPrinter<Policy> take the
+  // context as a template parameter instead
+  //
+  //   template <typename Context>
+  //   void format(const T& value, Context& context) const;
+  template <typename T, typename = void>
+  struct formatter : detail::default_formatter {};
+
+  namespace detail {
+
+    // Width of the precomputed run of spaces; deeper indentation is
+    // emitted in several slices
+    inline constexpr std::size_t whitespace_width = 128;
+
+    // ", \n" followed by whitespace_width spaces. Element delimiters,
+    // line breaks and indentation are all string_view slices of this buffer
+    constexpr std::array<char, whitespace_width + 3> make_whitespace() {
+      std::array<char, whitespace_width + 3> result{};
+      result[0] = ',';
+      result[1] = ' ';
+      result[2] = '\n';
+      for (std::size_t i = 3; i < result.size(); i++) {
+	result[i] = ' ';
+      }
+      return result;
     }
 
-    PrettyPrinter& quotes(bool value) {
-      quotes_ = value;
-      return *this;
-    }    
+    inline constexpr auto whitespace_buffer = make_whitespace();
+    inline constexpr std::string_view whitespace{whitespace_buffer.data(), whitespace_buffer.size()};
 
+    // Offsets into the whitespace buffer
+    inline constexpr std::size_t delimiter_offset = 0;  // ", \n" + indentation
+    inline constexpr std::size_t line_break_offset = 2; // "\n" + indentation
+    inline constexpr std::size_t indent_offset = 3;     // indentation only
+
+    inline constexpr std::string_view separator = whitespace.substr(0, 2);
+    inline constexpr std::string_view key_value_separator = " : ";
+
+    // Opening and closing bracket of a printed sequence
+    inline constexpr std::string_view square_brackets = "[]";
+    inline constexpr std::string_view curly_brackets = "{}";
+
+    // Marks the elements and characters left out by the truncation limits
+    inline constexpr std::string_view elision_prefix = "... (";
+    inline constexpr std::string_view elision_suffix = " more)";
+    // Marks where the output stopped once the byte budget ran out
+    inline constexpr std::string_view budget_marker = "...";
+
+    inline constexpr std::size_t unlimited = (std::numeric_limits<std::size_t>::max)();
+
+    // Integer types printed as numbers. Unlike std::is_integral, this
+    // excludes bool and char (printed as words and characters) and includes
+    // the 128-bit integers even in strict ISO mode
     template <typename T>
-    void print(T value) {
-      print_internal(value, 0, line_terminator_, 0);
-    }
+    struct is_integer : std::bool_constant<std::is_integral<T>::value &&
+					    !std::is_same<T, bool>::value &&
+					    !std::is_same<T, char>::value> {};
 
     template <typename T>
-    void print(std::initializer_list<T> value) {
-      print_internal(value, 0, line_terminator_, 0);
+    struct unsigned_integer {
+      using type = std::make_unsigned_t<T>;
+    };
+
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef __int128 int128;
+    __extension__ typedef unsigned __int128 uint128;
+
+    template <>
+    struct is_integer<int128> : std::true_type {};
+
+    template <>
+    struct is_integer<uint128> : std::true_type {};
+
+    template <>
+    struct unsigned_integer<int128> {
+      using type = uint128;
+    };
+
+    template <>
+    struct unsigned_integer<uint128> {
+      using type = uint128;
+    };
+#endif
+
+    // Upper bound on the characters needed to print any supported
+    // integer: 39 digits of a 128-bit magnitude plus the sign
+    inline constexpr std::size_t max_integer_chars = 40;
+
+    // "00", "01", ..., "99" back to back, for converting two digits at a time
+    constexpr std::array<char, 200> make_digit_pairs() {
+      std::array<char, 200> result{};
+      for (std::size_t i = 0; i < 100; i++) {
+	result[2 * i] = static_cast<char>('0' + i / 10);
+	result[2 * i + 1] = static_cast<char>('0' + i % 10);
+      }
+      return result;
     }
 
-    template<typename T, typename... Targs>
-    void print(T value, Targs... Fargs) {
-      print_internal(value, 0, "", 0);
-      auto current_quotes = quotes_;
-      quotes_ = false;
-      print_internal(" ", 0, "", 0);
-      quotes_ = current_quotes;
-      print(Fargs...);
+    inline constexpr auto digit_pairs = make_digit_pairs();
+
+    // Writes the digits of value so that they end just before `last` and
+    // returns the first digit. At least `min_digits` digits are written,
+    // padded with leading zeros
+    inline char * format_digits(char * last, std::uint64_t value, std::size_t min_digits = 1) {
+      char * first = last;
+      while (value >= 100) {
+	const std::size_t pair = static_cast<std::size_t>(value % 100) * 2;
+	value /= 100;
+	first -= 2;
+	first[0] = digit_pairs[pair];
+	first[1] = digit_pairs[pair + 1];
+      }
+      if (value >= 10) {
+	const std::size_t pair = static_cast<std::size_t>(value) * 2;
+	first -= 2;
+	first[0] = digit_pairs[pair];
+	first[1] = digit_pairs[pair + 1];
+      }
+      else {
+	*--first = static_cast<char>('0' + value);
+      }
+      while (static_cast<std::size_t>(last - first) < min_digits) {
+	*--first = '0';
+      }
+      return first;
     }
 
-    template <typename T>
-    void print_inline(T value) {
-      print_internal(value, indent_, "", 0);
+    inline std::size_t count_digits(std::uint64_t value) {
+      std::size_t count = 1;
+      for (;;) {
+	if (value < 10) return count;
+	if (value < 100) return count + 1;
+	if (value < 1000) return count + 2;
+	if (value < 10000) return count + 3;
+	value /= 10000;
+	count += 4;
+      }
     }
 
+    // Writes the decimal representation of value to `first`, which must
+    // have room for max_integer_chars characters. Returns one past the
+    // last character written
     template <typename T>
-    void print_inline(std::initializer_list<T> value) {
-      print_internal(value, indent_, "", 0);
-    }
+    char * format_integer(char * first, T value) {
+      using U = typename unsigned_integer<T>::type;
+      U magnitude = static_cast<U>(value);
+      if constexpr (static_cast<T>(-1) < static_cast<T>(0)) {
+	if (value < 0) {
+	  *first++ = '-';
+	  magnitude = static_cast<U>(U(0) - magnitude);
+	}
+      }
 
-    template<typename T, typename... Targs>
-    void print_inline(T value, Targs... Fargs) {
-      print_internal(value, indent_, "", 0);
-      auto current_quotes = quotes_;
-      quotes_ = false;
-      print_internal(" ", 0, "", 0);
-      quotes_ = current_quotes;
-      print_inline(Fargs...);
-    }    
+      if constexpr (sizeof(U) <= sizeof(std::uint64_t)) {
+	// Digits are written in place once their count is known
+	char * last = first + count_digits(magnitude);
+	format_digits(last, magnitude);
+	return last;
+      }
 
-  private:
+      char digits[max_integer_chars];
+      char * const last = digits + max_integer_chars;
+      char * begin = last;
+      if constexpr (sizeof(U) > sizeof(std::uint64_t)) {
+	// Peel off 19 digits at a time so that the remaining divisions
+	// are done in 64-bit arithmetic
+	constexpr std::uint64_t chunk = 10000000000000000000ull;
+	while (magnitude > (std::numeric_limits<std::uint64_t>::max)()) {
+	  begin = format_digits(begin, static_cast<std::uint64_t>(magnitude % chunk), 19);
+	  magnitude /= chunk;
+	}
+      }
+      begin = format_digits(begin, static_cast<std::uint64_t>(magnitude));
 
-    template <typename T>
-    typename std::enable_if<std::is_integral<T>::value == true, void>::type
-    print_internal(T value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << value << line_terminator;
+      const std::size_t count = static_cast<std::size_t>(last - begin);
+      std::memcpy(first, begin, count);
+      return first + count;
     }
 
+    // Room needed to format a floating-point value in the given format;
+    // only fixed notation grows with the magnitude of the value
     template <typename T>
-    typename std::enable_if<std::is_null_pointer<T>::value == true, void>::type
-    print_internal(T value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << "nullptr" << line_terminator;
+    constexpr std::size_t max_floating_chars(FloatFormat format, int precision) {
+      return 64 + static_cast<std::size_t>(precision) +
+	(format == FloatFormat::fixed ? std::numeric_limits<T>::max_exponent10 : 0);
     }
 
-    void print_internal(float value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << value << 'f' << line_terminator;
+#if defined(__cpp_lib_to_chars)
+    template <typename T>
+    std::to_chars_result to_chars(char * first, char * last, T value, FloatFormat format, int precision) {
+      switch (format) {
+      case FloatFormat::general:
+	return std::to_chars(first, last, value, std::chars_format::general, precision);
+      case FloatFormat::fixed:
+	return std::to_chars(first, last, value, std::chars_format::fixed, precision);
+      case FloatFormat::scientific:
+	return std::to_chars(first, last, value, std::chars_format::scientific, precision);
+      case FloatFormat::hex:
+	return std::to_chars(first, last, value, std::chars_format::hex);
+      default:
+	return std::to_chars(first, last, value);
+      }
+    }
+#else
+    // printf fallback for standard libraries without floating-point to_chars
+    template <typename T>
+    int snprintf_floating(char * first, std::size_t size, T value, const char * conversion, int precision) {
+      char specifier[8] = "%.*";
+      std::size_t length = 3;
+      if (std::is_same<T, long double>::value)
+	specifier[length++] = 'L';
+      specifier[length++] = *conversion;
+      specifier[length] = '\0';
+      return std::snprintf(first, size, specifier, precision, value);
     }
 
-    void print_internal(double value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << value << line_terminator;
+    template <typename T>
+    char * snprintf_shortest(char * first, std::size_t size, T value) {
+      // Increase the precision until the text reads back as the same value
+      int written = 0;
+      for (int precision = std::numeric_limits<T>::digits10;
+	   precision <= std::numeric_limits<T>::max_digits10; precision++) {
+	written = snprintf_floating(first, size, value, "g", precision);
+	if (written < 0 || static_cast<std::size_t>(written) >= size)
+	  return nullptr;
+	if (static_cast<T>(std::strtold(first, nullptr)) == value)
+	  break;
+      }
+      return first + written;
     }
+#endif
 
-    void print_internal(const std::string& value, size_t indent = 0, const std::string& line_terminator = "\n",
-			size_t level = 0) {
-      if (!quotes_)
-	print_internal_without_quotes(value, indent, line_terminator, level);
-      else
-	stream_ << std::string(indent, ' ') << "\"" << value << "\"" << line_terminator;
+    // Writes value to [first, last) without the 0x prefix of hexadecimal
+    // notation. Returns one past the last character written, or nullptr
+    // if the range is too small
+    template <typename T>
+    char * format_floating_digits(char * first, char * last, T value, FloatFormat format, int precision) {
+#if defined(__cpp_lib_to_chars)
+      const auto result = to_chars(first, last, value, format, precision);
+      return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+      const std::size_t size = static_cast<std::size_t>(last - first);
+      if (format == FloatFormat::shortest)
+	return snprintf_shortest(first, size, value);
+      const char * conversion = format == FloatFormat::general ? "g" :
+	format == FloatFormat::fixed ? "f" : format == FloatFormat::scientific ? "e" : "a";
+      // A negative precision means "exact" to %a, matching to_chars
+      int written = snprintf_floating(first, size, value, conversion,
+				      format == FloatFormat::hex ? -1 : precision);
+      if (written < 0 || static_cast<std::size_t>(written) >= size)
+	return nullptr;
+      if (format == FloatFormat::hex) {
+	// %a includes the 0x prefix that to_chars leaves out
+	char * prefix = first + (*first == '-' ? 1 : 0);
+	if (prefix[0] == '0' && (prefix[1] == 'x' || prefix[1] == 'X')) {
+	  std::memmove(prefix, prefix + 2, static_cast<std::size_t>(first + written - prefix - 2));
+	  written -= 2;
+	}
+      }
+      return first + written;
+#endif
     }
-    
-    void print_internal(const char * value, size_t indent = 0, const std::string& line_terminator = "\n",
-			size_t level = 0) {
-      if (!quotes_)
-	print_internal_without_quotes(value, indent, line_terminator, level);
-      else
-	stream_ << std::string(indent, ' ') << "\"" << value << "\"" << line_terminator;
+
+    // Writes value to [first, last), including the 0x prefix of finite
+    // hexadecimal floats. Returns one past the last character written, or
+    // nullptr if the range is too small
+    template <typename T>
+    char * format_floating(char * first, char * last, T value, FloatFormat format, int precision) {
+      if (format == FloatFormat::hex && std::isfinite(value)) {
+	if (last - first < 3)
+	  return nullptr;
+	if (std::signbit(value)) {
+	  *first++ = '-';
+	  value = -value;
+	}
+	*first++ = '0';
+	*first++ = 'x';
+      }
+      return format_floating_digits(first, last, value, format, precision);
     }
 
-    void print_internal(char value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      if (!quotes_)
-	print_internal_without_quotes(value, indent, line_terminator, level);
-      else
-	stream_ << std::string(indent, ' ') << "'" << value << "'" << line_terminator;
-    }    
+    // Read-only access to the protected members of the standard container
+    // adaptors, so that they can be printed in place
+    template <typename Adaptor>
+    struct adaptor_access : Adaptor {
+      static const typename Adaptor::container_type& container(const Adaptor& adaptor) {
+	return adaptor.*(&adaptor_access::c);
+      }
 
-    void print_internal_without_quotes(const std::string& value, size_t indent = 0,
-				       const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << value << line_terminator;
-    }
-    
-    void print_internal_without_quotes(const char * value, size_t indent = 0,
-				       const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << value << line_terminator;
-    }    
+      // Only std::priority_queue has a comparator
+      template <typename A = Adaptor>
+      static const typename A::value_compare& compare(const Adaptor& adaptor) {
+	return adaptor.*(&adaptor_access::comp);
+      }
+    };
 
-    void print_internal_without_quotes(char value, size_t indent = 0, const std::string& line_terminator = "\n",
-				       size_t level = 0) {
-      stream_ << std::string(indent, ' ') << value << line_terminator;
-    }        
-    
-    void print_internal(bool value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') <<
-	(value ? "true" : "false") << line_terminator;
-    }
+    template <typename T, typename = void>
+    struct is_less_comparable : std::false_type {};
 
     template <typename T>
-    typename std::enable_if<std::is_pointer<T>::value == true, void>::type
-    print_internal(T value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      if (value == nullptr) {
-	return print_internal(nullptr, indent, line_terminator, level);
+    struct is_less_comparable<T, std::void_t<decltype(std::declval<const T&>() < std::declval<const T&>())>>
+      : std::true_type {};
+
+    struct dereference {
+      template <typename Iterator>
+      decltype(auto) operator()(const Iterator& iterator) const {
+	return *iterator;
+      }
+    };
+
+    struct dereference_twice {
+      template <typename Iterator>
+      decltype(auto) operator()(const Iterator& iterator) const {
+	return **iterator;
+      }
+    };
+
+    // Map entry printed as "key : value"
+    template <typename Key, typename Value>
+    struct key_value_ref {
+      const Key& key;
+      const Value& value;
+    };
+
+    struct key_value {
+      template <typename Iterator>
+      auto operator()(const Iterator& iterator) const {
+	typedef std::decay_t<decltype(iterator->first)> Key;
+	typedef std::decay_t<decltype(iterator->second)> Value;
+	return key_value_ref<Key, Value>{iterator->first, iterator->second};
       }
-      stream_ << std::string(indent, ' ') << "<" << type(value) << " at "
-	      << value << ">" << line_terminator;
+    };
+
+    // How the standard containers are printed by the generic range printer:
+    // their brackets, how an element is obtained from an iterator and
+    // whether the elements are contiguous (for the batch kernel)
+    template <typename Range>
+    struct range_traits {
+      static constexpr bool is_range = false;
+    };
+
+    template <bool Contiguous = false>
+    struct sequence_traits {
+      static constexpr bool is_range = true;
+      static constexpr bool contiguous = Contiguous;
+      static constexpr std::string_view brackets = square_brackets;
+      typedef dereference projection;
+    };
+
+    template <typename Projection = dereference>
+    struct associative_traits {
+      static constexpr bool is_range = true;
+      static constexpr bool contiguous = false;
+      static constexpr std::string_view brackets = curly_brackets;
+      typedef Projection projection;
+    };
+
+    template <typename... Ts>
+    struct range_traits<std::vector<Ts...>> : sequence_traits<true> {};
+
+    template <typename T, std::size_t N>
+    struct range_traits<std::array<T, N>> : sequence_traits<true> {};
+
+    template <typename... Ts>
+    struct range_traits<std::list<Ts...>> : sequence_traits<> {};
+
+    template <typename... Ts>
+    struct range_traits<std::deque<Ts...>> : sequence_traits<> {};
+
+    template <typename... Ts>
+    struct range_traits<std::set<Ts...>> : associative_traits<> {};
+
+    template <typename... Ts>
+    struct range_traits<std::multiset<Ts...>> : associative_traits<> {};
+
+    template <typename... Ts>
+    struct range_traits<std::unordered_set<Ts...>> : associative_traits<> {};
+
+    template <typename... Ts>
+    struct range_traits<std::unordered_multiset<Ts...>> : associative_traits<> {};
+
+    template <typename... Ts>
+    struct range_traits<std::map<Ts...>> : associative_traits<key_value> {};
+
+    template <typename... Ts>
+    struct range_traits<std::multimap<Ts...>> : associative_traits<key_value> {};
+
+    template <typename... Ts>
+    struct range_traits<std::unordered_map<Ts...>> : associative_traits<key_value> {};
+
+    template <typename... Ts>
+    struct range_traits<std::unordered_multimap<Ts...>> : associative_traits<key_value> {};
+
+    template <typename T>
+    struct has_formatter : std::bool_constant<!std::is_base_of<default_formatter, formatter<T>>::value> {};
+
+    // How a type is printed, in order of precedence
+    enum class category {
+      formatted,  // formatter<T> specialization
+      scalar,     // Numbers, bool, characters, enums, nullptr and std::complex
+      string,     // std::string, std::string_view and const char *
+      range,      // Sequence and set containers
+      map,        // Map containers
+      tuple,      // std::pair and std::tuple
+      pointer,    // Raw, smart and member function pointers
+      adaptor,    // std::queue, std::priority_queue and std::stack
+      wrapper,    // std::optional and std::variant
+      streamable, // Other classes with an operator<<
+      opaque,     // Other classes, printed by type name
+      other       // Remaining types, e.g., C arrays
+    };
+
+    // Category of the standard library templates that are not ranges,
+    // matched by partial specialization rather than one check per template
+    template <typename T>
+    struct template_category : std::integral_constant<category, category::other> {};
+
+    template <typename... Ts>
+    struct template_category<std::complex<Ts...>> : std::integral_constant<category, category::scalar> {};
+
+    template <typename... Ts>
+    struct template_category<std::initializer_list<Ts...>> : std::integral_constant<category, category::range> {};
+
+    template <typename... Ts>
+    struct template_category<std::pair<Ts...>> : std::integral_constant<category, category::tuple> {};
+
+    template <typename... Ts>
+    struct template_category<std::tuple<Ts...>> : std::integral_constant<category, category::tuple> {};
+
+    template <typename... Ts>
+    struct template_category<std::unique_ptr<Ts...>> : std::integral_constant<category, category::pointer> {};
+
+    template <typename... Ts>
+    struct template_category<std::shared_ptr<Ts...>> : std::integral_constant<category, category::pointer> {};
+
+    template <typename... Ts>
+    struct template_category<std::weak_ptr<Ts...>> : std::integral_constant<category, category::pointer> {};
+
+    template <typename... Ts>
+    struct template_category<std::queue<Ts...>> : std::integral_constant<category, category::adaptor> {};
+
+    template <typename... Ts>
+    struct template_category<std::priority_queue<Ts...>> : std::integral_constant<category, category::adaptor> {};
+
+    template <typename... Ts>
+    struct template_category<std::stack<Ts...>> : std::integral_constant<category, category::adaptor> {};
+
+    template <typename... Ts>
+    struct template_category<std::optional<Ts...>> : std::integral_constant<category, category::wrapper> {};
+
+    template <typename... Ts>
+    struct template_category<std::variant<Ts...>> : std::integral_constant<category, category::wrapper> {};
+
+    template <typename T>
+    constexpr category categorize() {
+      if constexpr (has_formatter<T>::value)
+	return category::formatted;
+      else if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_null_pointer<T>::value)
+	return category::scalar;
+      else if constexpr (std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value ||
+			 std::is_same<T, const char *>::value)
+	return category::string;
+      else if constexpr (range_traits<T>::is_range)
+	return std::is_same<typename range_traits<T>::projection, key_value>::value ? category::map : category::range;
+      else if constexpr (template_category<T>::value != category::other)
+	return template_category<T>::value;
+      else if constexpr (std::is_pointer<T>::value || std::is_member_function_pointer<T>::value)
+	return category::pointer;
+      else if constexpr (std::is_class<T>::value && is_to_stream_writable<std::ostream, T>::value)
+	return category::streamable;
+      else if constexpr (std::is_class<T>::value)
+	return category::opaque;
+      else
+	return category::other;
     }
 
-    std::string demangle(const char* name) {
-#ifdef __GNUG__
-      int status = -4;      
-      std::unique_ptr<char, void(*)(void*)> res {
-        abi::__cxa_demangle(name, NULL, NULL, &status),
-	  std::free
-	  };
-      return (status==0) ? res.get() : name;
+    // Resolved once per type
+    template <typename T>
+    inline constexpr category category_v = categorize<std::remove_cv_t<T>>();
+
+    // Types printed by the generic object overload rather than a dedicated one
+    template <typename T>
+    struct is_object_category : std::bool_constant<category_v<T> == category::formatted ||
+						    category_v<T> == category::streamable ||
+						    category_v<T> == category::opaque> {};
+
+    // Element types handled by the batch formatting kernel
+    template <typename T>
+    struct is_batch_arithmetic : std::bool_constant<is_integer<T>::value ||
+						     std::is_floating_point<T>::value> {};
+
+    // Name of T as spelled by the compiler, extracted from the signature of
+    // this function in the same way as magic_enum extracts enum names.
+    // Empty on unsupported compilers
+    template <typename T>
+    [[nodiscard]] constexpr std::string_view type_name_impl() noexcept {
+#if defined(__clang__)
+      std::string_view name{__PRETTY_FUNCTION__};
+      constexpr std::string_view prefix = "[T = ";
+      constexpr auto suffix = sizeof("]") - 1;
+#elif defined(__GNUC__) && __GNUC__ >= 9
+      std::string_view name{__PRETTY_FUNCTION__};
+      constexpr std::string_view prefix = "[with T = ";
+      constexpr auto suffix = sizeof("; std::string_view = std::basic_string_view<char>]") - 1;
+#elif defined(_MSC_VER)
+      std::string_view name{__FUNCSIG__};
+      constexpr std::string_view prefix = "type_name_impl<";
+      constexpr auto suffix = sizeof(">(void) noexcept") - 1;
 #else
+      return {}; // Unsupported compiler.
+#endif
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9) || defined(_MSC_VER)
+      const std::size_t start = name.find(prefix);
+      if (start == std::string_view::npos || name.size() < start + prefix.size() + suffix)
+	return {};
+      name.remove_prefix(start + prefix.size());
+      name.remove_suffix(suffix);
       return name;
-#endif      
+#endif
     }
 
-    template <class T>
-    std::string type(const T& t) {
-      return demangle(typeid(t).name());
+    [[nodiscard]] constexpr bool starts_with(std::string_view name, std::size_t position,
+					     std::string_view prefix) noexcept {
+      return name.substr(position, prefix.size()) == prefix;
     }
 
-    template <typename T>
-    typename std::enable_if<std::is_enum<T>::value == true, void>::type
-    print_internal(T value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      auto enum_string = magic_enum::enum_name(value);
-      if (enum_string.has_value()) {
-	stream_ << std::string(indent, ' ') << enum_string.value()
-		<< line_terminator;
-      }
-      else {
-	stream_ << std::string(indent, ' ') << value
-		<< line_terminator;
+    // Index of the '>' that closes the '<' at position open
+    [[nodiscard]] constexpr std::size_t closing_bracket(std::string_view name, std::size_t open) noexcept {
+      std::size_t depth = 0;
+      for (std::size_t i = open; i < name.size(); i++) {
+	if (name[i] == '<')
+	  depth += 1;
+	else if (name[i] == '>' && --depth == 0)
+	  return i;
       }
+      return name.size();
     }
 
-    template <typename T>
-    typename std::enable_if<std::is_class<T>::value == true &&
-			    is_to_stream_writable<std::ostream, T>::value == true &&
-			    std::is_enum<T>::value == false &&
-			    is_specialization<T, std::unique_ptr>::value == false &&
-			    is_specialization<T, std::shared_ptr>::value == false &&
-			    is_specialization<T, std::weak_ptr>::value == false &&
-			    is_specialization<T, std::tuple>::value == false &&
-			    is_specialization<T, std::variant>::value == false &&
-			    is_specialization<T, std::vector>::value == false &&
-			    is_specialization<T, std::list>::value == false &&
-			    is_specialization<T, std::deque>::value == false &&
-			    is_specialization<T, std::queue>::value == false &&
-			    is_specialization<T, std::priority_queue>::value == false &&
-			    is_specialization<T, std::stack>::value == false &&
-			    is_specialization<T, std::set>::value == false &&
-			    is_specialization<T, std::multiset>::value == false &&
-			    is_specialization<T, std::unordered_set>::value == false &&
-			    is_specialization<T, std::unordered_multiset>::value == false &&			    
-			    is_specialization<T, std::map>::value == false &&
-			    is_specialization<T, std::multimap>::value == false &&
-			    is_specialization<T, std::unordered_map>::value == false &&
-			    is_specialization<T, std::unordered_multimap>::value == false, void>::type
-    print_internal(T value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << value
-	      << line_terminator;
+    [[nodiscard]] constexpr bool is_name_char(char c) noexcept {
+      return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == ':';
     }
 
-    template <typename T>
-    typename std::enable_if<std::is_class<T>::value == true &&
-			    is_to_stream_writable<std::ostream, T>::value == false &&
-			    std::is_enum<T>::value == false &&
-			    is_specialization<T, std::unique_ptr>::value == false &&
-			    is_specialization<T, std::shared_ptr>::value == false &&
-			    is_specialization<T, std::weak_ptr>::value == false &&
-			    is_specialization<T, std::tuple>::value == false &&
-			    is_specialization<T, std::variant>::value == false &&
-			    is_specialization<T, std::vector>::value == false &&
-			    is_specialization<T, std::list>::value == false &&
-			    is_specialization<T, std::deque>::value == false &&
-			    is_specialization<T, std::queue>::value == false &&
-			    is_specialization<T, std::priority_queue>::value == false &&
-			    is_specialization<T, std::stack>::value == false &&
-			    is_specialization<T, std::set>::value == false &&
-			    is_specialization<T, std::multiset>::value == false &&
-			    is_specialization<T, std::unordered_set>::value == false &&
-			    is_specialization<T, std::unordered_multiset>::value == false &&			    
-			    is_specialization<T, std::map>::value == false &&
-			    is_specialization<T, std::multimap>::value == false &&
-			    is_specialization<T, std::unordered_map>::value == false &&
-			    is_specialization<T, std::unordered_multimap>::value == false, void>::type
-    print_internal(T value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << "<Object " << type(value) << ">"
-	      << line_terminator;
+    // Whether `name` is the concatenation of `pieces`
+    template <std::size_t N>
+    [[nodiscard]] constexpr bool spelled_as(std::string_view name, const std::string_view (&pieces)[N]) noexcept {
+      std::size_t position = 0;
+      for (std::string_view piece : pieces) {
+	if (!starts_with(name, position, piece))
+	  return false;
+	position += piece.size();
+      }
+      return position == name.size();
     }
 
-    template <typename T>
-    typename std::enable_if<std::is_member_function_pointer<T>::value == true, void>::type
-    print_internal(T value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      stream_ << std::string(indent, ' ') << "<Object.method " << type(value)
-	      << " at " << &value << ">"
-	      << line_terminator;
+    // Whether `argument`, the template argument at `index` of `name`, is
+    // the default for it given the first two arguments: the allocator,
+    // comparator, hash, key equality, character traits or deleter that
+    // the standard containers, strings and std::unique_ptr use when the
+    // argument is left out
+    [[nodiscard]] constexpr bool is_default_argument(std::string_view name, std::size_t index,
+						     std::string_view first, std::string_view second,
+						     std::string_view argument) noexcept {
+      const auto of_first = [&](std::string_view tmpl) { return spelled_as(argument, {tmpl, first, ">"}); };
+      // std::allocator<std::pair<const Key, T>>, with the const of a
+      // pointer key spelled after it
+      const auto of_entry = [&] {
+	return spelled_as(argument, {"std::allocator<std::pair<const ", first, ", ", second, ">>"}) ||
+	  spelled_as(argument, {"std::allocator<std::pair<", first, " const, ", second, ">>"});
+      };
+      if (name == "std::vector" || name == "std::deque" || name == "std::list" || name == "std::forward_list")
+	return index == 1 && of_first("std::allocator<");
+      if (name == "std::set" || name == "std::multiset")
+	return (index == 1 && of_first("std::less<")) || (index == 2 && of_first("std::allocator<"));
+      if (name == "std::map" || name == "std::multimap")
+	return (index == 2 && of_first("std::less<")) || (index == 3 && of_entry());
+      if (name == "std::unordered_set" || name == "std::unordered_multiset")
+	return (index == 1 && of_first("std::hash<")) || (index == 2 && of_first("std::equal_to<")) ||
+	  (index == 3 && of_first("std::allocator<"));
+      if (name == "std::unordered_map" || name == "std::unordered_multimap")
+	return (index == 2 && of_first("std::hash<")) || (index == 3 && of_first("std::equal_to<")) ||
+	  (index == 4 && of_entry());
+      if (name == "std::basic_string" || name == "std::basic_string_view")
+	return (index == 1 && of_first("std::char_traits<")) || (index == 2 && of_first("std::allocator<"));
+      if (name == "std::unique_ptr")
+	return index == 1 && of_first("std::default_delete<");
+      return false;
     }
 
-    template <typename Container>
-    typename std::enable_if<is_specialization<Container, std::vector>::value, void>::type    
-    print_internal(const Container& value, size_t indent = 0, const std::string& line_terminator = "\n",
-		   size_t level = 0) {
-      typedef typename Container::value_type T;
-      if (level == 0 && !compact_) {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("[", 0, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("[", 0, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	}
-	else if (value.size() > 0) {
-	  print_internal_without_quotes("[", 0, "\n");
-	  print_internal(value.front(), indent + indent_, "", level + 1);
-	  if (value.size() > 1 && is_container<T>::value == false)
-	    print_internal_without_quotes(", ", 0, "\n");
-	  else if (is_container<T>::value)
-	    print_internal_without_quotes(", ", 0, "\n");
-	  for (size_t i = 1; i < value.size() - 1; i++) {
-	    print_internal(value[i], indent + indent_, "", level + 1);
-	    if (is_container<T>::value == false)
-	      print_internal_without_quotes(", ", 0, "\n");
-	    else
-	      print_internal_without_quotes(", ", 0, "\n");	    
-	  }
-	  if (value.size() > 1) {
-	    print_internal(value.back(), indent + indent_, "\n", level + 1);
-	  }
+    // Copies the type that starts at name[i] to out[size], up to the ',' or
+    // '>' that ends it. Drops the space in "> >", and the trailing template
+    // arguments that are defaults (see is_default_argument), comparing the
+    // arguments in their shortened form. Writes behind the position it
+    // reads from, so out may alias name
+    constexpr void shorten_arguments(std::string_view name, std::size_t& i, char * out, std::size_t& size) noexcept {
+      while (i < name.size() && name[i] != ',' && name[i] != '>') {
+	if (name[i] == ' ' && starts_with(name, i + 1, ">")) {
+	  i += 1;
+	  continue;
 	}
-	if (value.size() == 0)
-	  print_internal_without_quotes("]", indent, "");
-	else if (is_container<T>::value == false)
-	  print_internal_without_quotes("]", indent, "");
-	else
-	  print_internal_without_quotes(line_terminator_ + "]", indent, "");
-	print_internal_without_quotes(line_terminator_, 0, "");
-      }
-      else {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("[", indent, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("[", indent, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	}
-	else if (value.size() > 0) {
-	  print_internal_without_quotes("[", indent, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	  if (value.size() > 1)
-	    print_internal_without_quotes(", ", 0, "");
-	  for (size_t i = 1; i < value.size() - 1; i++) {	      
-	    print_internal(value[i], 0, "", level + 1);
-	    print_internal_without_quotes(", ", 0, "");
-	  }
-	  if (value.size() > 1) {
-	    print_internal(value.back(), 0, "", level + 1);
+	if (name[i] != '<') {
+	  out[size++] = name[i++];
+	  continue;
+	}
+	std::size_t name_start = size;
+	while (name_start > 0 && is_name_char(out[name_start - 1]))
+	  name_start -= 1;
+	const std::string_view template_name(out + name_start, size - name_start);
+	out[size++] = name[i++];
+
+	std::string_view arguments[2];
+	std::size_t kept = size; // End of the arguments that are kept
+	for (std::size_t index = 0;; index++) {
+	  if (index > 0) {
+	    out[size++] = name[i++];
+	    if (starts_with(name, i, " "))
+	      out[size++] = name[i++];
 	  }
+	  const std::size_t start = size;
+	  shorten_arguments(name, i, out, size);
+	  const std::string_view argument(out + start, size - start);
+	  if (index < 2)
+	    arguments[index] = argument;
+	  if (index == 0 || !is_default_argument(template_name, index, arguments[0], arguments[1], argument))
+	    kept = size;
+	  if (i >= name.size() || name[i] != ',')
+	    break;
 	}
-	print_internal_without_quotes("]", 0, "");
-	if (level == 0 && compact_)
-	  print_internal_without_quotes(line_terminator_, 0, "");
+	size = kept;
+	if (i < name.size())
+	  out[size++] = name[i++];
       }
-      
     }
 
-    template <typename T, unsigned long int S>
-    void print_internal(const std::array<T, S>& value, size_t indent = 0, const std::string& line_terminator = "\n",
-			size_t level = 0) {
-      if (level == 0 && !compact_) {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("[", 0, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("[", 0, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	}
-	else if (value.size() > 0) {
-	  print_internal_without_quotes("[", 0, "\n");
-	  print_internal(value.front(), indent + indent_, "", level + 1);
-	  if (value.size() > 1 && is_container<T>::value == false)
-	    print_internal_without_quotes(", ", 0, "\n");
-	  else if (is_container<T>::value)
-	    print_internal_without_quotes(", ", 0, "\n");
-	  for (size_t i = 1; i < value.size() - 1; i++) {
-	    print_internal(value[i], indent + indent_, "", level + 1);
-	    if (is_container<T>::value == false)
-	      print_internal_without_quotes(", ", 0, "\n");
-	    else
-	      print_internal_without_quotes(", ", 0, "\n");	    
-	  }
-	  if (value.size() > 1) {
-	    print_internal(value.back(), indent + indent_, "\n", level + 1);
-	  }
-	}
-	if (value.size() == 0)
-	  print_internal_without_quotes("]", indent, "");
-	else if (is_container<T>::value == false)
-	  print_internal_without_quotes("]", indent, "");
-	else
-	  print_internal_without_quotes(line_terminator_ + "]", indent, "");
-	print_internal_without_quotes(line_terminator_, 0, "");	
-      }
-      else {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("[", indent, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("[", indent, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	}
-	else if (value.size() > 0) {
-	  print_internal_without_quotes("[", indent, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	  if (value.size() > 1)
-	    print_internal_without_quotes(", ", 0, "");
-	  for (size_t i = 1; i < value.size() - 1; i++) {	      
-	    print_internal(value[i], 0, "", level + 1);
-	    print_internal_without_quotes(", ", 0, "");
-	  }
-	  if (value.size() > 1) {
-	    print_internal(value.back(), 0, "", level + 1);
+    // Rewrites standard library spellings in a type name to their short
+    // aliases. Drops the inline namespaces std::__cxx11 and std::__1 and
+    // the template arguments that are defaults (e.g., the allocator of
+    // std::vector<int, std::allocator<int>>, but not std::less<void> in a
+    // std::set<int, std::less<void>>), spells std::basic_string<char> as
+    // std::string and closes nested templates with ">>" instead of "> >".
+    // Writes at most name.size() characters to out, which may alias name,
+    // and returns the new length
+    [[nodiscard]] constexpr std::size_t shorten_type_name(std::string_view name, char * out) noexcept {
+      constexpr std::string_view inline_namespaces[] = {"std::__cxx11::", "std::__1::"};
+      constexpr std::string_view aliases[][2] = {
+	{"std::basic_string<char>", "std::string"},
+	{"std::basic_string<wchar_t>", "std::wstring"},
+	{"std::basic_string_view<char>", "std::string_view"}};
+
+      // Every pass writes behind the position it reads from, so all of them
+      // run in place on out
+      std::size_t size = 0;
+      for (std::size_t i = 0; i < name.size();) {
+	bool skipped = false;
+	for (std::string_view prefix : inline_namespaces) {
+	  if (starts_with(name, i, prefix)) {
+	    for (char c : std::string_view("std::"))
+	      out[size++] = c;
+	    i += prefix.size();
+	    skipped = true;
+	    break;
 	  }
 	}
-	print_internal_without_quotes("]", 0, "");
-	if (level == 0 && compact_)
-	  print_internal_without_quotes(line_terminator_, 0, "");
+	if (!skipped)
+	  out[size++] = name[i++];
       }
-      
-    }    
 
-    template <typename Container>
-    typename std::enable_if<is_specialization<Container, std::list>::value ||
-			    is_specialization<Container, std::deque>::value, void>::type    
-    print_internal(const Container& value, size_t indent = 0, const std::string& line_terminator = "\n",
-		   size_t level = 0) {
-      typedef typename Container::value_type T;
-      if (level == 0 && !compact_) {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("[", 0, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("[", 0, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	}
-	else if (value.size() > 0) {
-	  print_internal_without_quotes("[", 0, "\n");
-	  print_internal(value.front(), indent + indent_, "", level + 1);
-	  if (value.size() > 1 && is_container<T>::value == false)
-	    print_internal_without_quotes(", ", 0, "\n");
-	  else if (is_container<T>::value)
-	    print_internal_without_quotes(", ", 0, "\n");
-
-	  typename Container::const_iterator iterator;
-	  for (iterator = std::next(value.begin()); iterator != std::prev(value.end()); ++iterator) {
-	    print_internal(*iterator, indent + indent_, "", level + 1);
-	    if (is_container<T>::value == false)
-	      print_internal_without_quotes(", ", 0, "\n");
-	    else
-	      print_internal_without_quotes(", ", 0, "\n");	    
-	  }
-	  
-	  if (value.size() > 1) {
-	    print_internal(value.back(), indent + indent_, "\n", level + 1);
-	  }
-	}
-	if (value.size() == 0)
-	  print_internal_without_quotes("]", indent, "");
-	else if (is_container<T>::value == false)
-	  print_internal_without_quotes("]", indent, "");
-	else
-	  print_internal_without_quotes(line_terminator_ + "]", indent, "");
-	print_internal_without_quotes(line_terminator_, 0, "");	
+      std::string_view current(out, size);
+      size = 0;
+      // Commas and brackets outside a template argument list (e.g., of a
+      // function type) are copied as they are
+      for (std::size_t i = 0; i < current.size();) {
+	shorten_arguments(current, i, out, size);
+	if (i < current.size())
+	  out[size++] = current[i++];
       }
-      else {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("[", indent, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("[", indent, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	}
-	else if (value.size() > 0) {
-	  print_internal_without_quotes("[", indent, "");
-	  print_internal(value.front(), 0, "", level + 1);
-	  if (value.size() > 1)
-	    print_internal_without_quotes(", ", 0, "");
-
-	  typename Container::const_iterator iterator;
-	  for (iterator = std::next(value.begin()); iterator != std::prev(value.end()); ++iterator) {
-	    print_internal(*iterator, 0, "", level + 1);
-	    print_internal_without_quotes(", ", 0, "");	    
-	  }
 
-	  if (value.size() > 1) {
-	    print_internal(value.back(), 0, "", level + 1);
+      current = std::string_view(out, size);
+      size = 0;
+      for (std::size_t i = 0; i < current.size();) {
+	bool replaced = false;
+	for (const auto& alias : aliases) {
+	  if (starts_with(current, i, alias[0])) {
+	    for (char c : alias[1])
+	      out[size++] = c;
+	    i += alias[0].size();
+	    replaced = true;
+	    break;
 	  }
 	}
-	print_internal_without_quotes("]", 0, "");
-	if (level == 0 && compact_)
-	  print_internal_without_quotes(line_terminator_, 0, "");	
+	if (!replaced)
+	  out[size++] = current[i++];
       }
-      
+      return size;
     }
 
-    template <typename Container>
-    typename std::enable_if<is_specialization<Container, std::set>::value ||
-			    is_specialization<Container, std::multiset>::value ||
-			    is_specialization<Container, std::unordered_set>::value ||
-			    is_specialization<Container, std::unordered_multiset>::value, void>::type    
-    print_internal(const Container& value, size_t indent = 0, const std::string& line_terminator = "\n",
-		   size_t level = 0) {
-      typedef typename Container::value_type T;
-      if (level == 0 && !compact_) {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("{", 0, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("{", 0, "");
-	  print_internal(*(value.begin()), 0, "", level + 1);
-	}
-	else if (value.size() > 0) {
-	  print_internal_without_quotes("{", 0, "\n");
-	  print_internal(*(value.begin()), indent + indent_, "", level + 1);
-	  if (value.size() > 1 && is_container<T>::value == false)
-	    print_internal_without_quotes(", ", 0, "\n");
-	  else if (is_container<T>::value)
-	    print_internal_without_quotes(", ", 0, "\n");
-
-	  typename Container::const_iterator iterator;
-	  for (iterator = std::next(value.begin()); iterator != std::prev(value.end()); ++iterator) {
-	    print_internal(*iterator, indent + indent_, "", level + 1);
-	    if (is_container<T>::value == false)
-	      print_internal_without_quotes(", ", 0, "\n");
-	    else
-	      print_internal_without_quotes(", ", 0, "\n");	    
-	  }
-	  
-	  if (value.size() > 1) {
-	    print_internal(*(std::prev(value.end())), indent + indent_, "\n", level + 1);
-	  }
-	}
-	if (value.size() == 0)
-	  print_internal_without_quotes("}", indent, "");
-	else if (is_container<T>::value == false)
-	  print_internal_without_quotes("}", indent, "");
-	else
-	  print_internal_without_quotes(line_terminator_ + "}", indent, "");
-	print_internal_without_quotes(line_terminator_, 0, "");	
-      }
-      else {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("{", indent, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("{", indent, "");
-	  print_internal(*(value.begin()), 0, "", level + 1);
-	}
-	else if (value.size() > 0) {
-	  print_internal_without_quotes("{", indent, "");
-	  print_internal(*(value.begin()), 0, "", level + 1);
-	  if (value.size() > 1)
-	    print_internal_without_quotes(", ", 0, "");
-
-	  typename Container::const_iterator iterator;
-	  for (iterator = std::next(value.begin()); iterator != std::prev(value.end()); ++iterator) {
-	    print_internal(*iterator, 0, "", level + 1);
-	    print_internal_without_quotes(", ", 0, "");	    
-	  }
+    template <std::size_t N>
+    struct type_name_storage {
+      char data[N + 1] = {};
+      std::size_t size = 0;
 
-	  if (value.size() > 1) {
-	    print_internal(*(std::prev(value.end())), 0, "", level + 1);
-	  }
-	}
-	print_internal_without_quotes("}", 0, "");
-	if (level == 0 && compact_)
-	  print_internal_without_quotes(line_terminator_, 0, "");
+      [[nodiscard]] constexpr std::string_view view() const noexcept {
+	return {data, size};
       }
-      
-    }    
+    };
 
     template <typename T>
-    typename std::enable_if<is_specialization<T, std::map>::value == true ||
-			    is_specialization<T, std::multimap>::value == true ||
-			    is_specialization<T, std::unordered_map>::value == true ||
-			    is_specialization<T, std::unordered_multimap>::value == true, void>::type
-    print_internal(const T& value, size_t indent = 0, const std::string& line_terminator = "\n", size_t level = 0) {
-      typedef typename T::mapped_type Value;
-      if (level == 0 && !compact_) {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("{", 0, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("{", 0, "");
-	  for (auto& kvpair : value) {
-	    print_internal(kvpair.first, 0, "", level + 1);
-	    print_internal_without_quotes(" : ", 0, "");
-	    print_internal(kvpair.second, 0, "", level + 1);
-	  }
-	}
-	else if (value.size() > 0) {
-	  size_t count = 0;
-	  for (auto& kvpair : value) {
-	    if (count == 0) {
-	      print_internal_without_quotes("{", 0, "\n");
-	      print_internal(kvpair.first, indent + indent_, "", level + 1);
-	      print_internal_without_quotes(" : ", 0, "");
-	      print_internal(kvpair.second, 0, "", level + 1);
-	      if (value.size() > 1 && is_container<Value>::value == false)
-		print_internal_without_quotes(", ", 0, "\n");
-	      else if (is_container<Value>::value)
-		print_internal_without_quotes(", ", 0, "\n");
-	    }
-	    else if (count + 1 < value.size()) {
-	      print_internal(kvpair.first, indent + indent_, "", level + 1);
-	      print_internal_without_quotes(" : ", 0, "");
-	      print_internal(kvpair.second, 0, "", level + 1);
-	      if (is_container<Value>::value == false)
-		print_internal_without_quotes(", ", 0, "\n");
-	      else
-		print_internal_without_quotes(", ", 0, "\n");
-	    }
-	    else {
-	      print_internal(kvpair.first, indent + indent_, "", level + 1);
-	      print_internal_without_quotes(" : ", 0, "");
-	      print_internal(kvpair.second, 0, "\n", level + 1);
-	    }
-	    count += 1;
-	  }	  
+    [[nodiscard]] constexpr auto make_type_name() noexcept {
+      constexpr std::string_view name = type_name_impl<T>();
+      type_name_storage<name.size()> storage;
+      storage.size = shorten_type_name(name, storage.data);
+      return storage;
+    }
+
+    template <typename T>
+    inline constexpr auto type_name_storage_v = make_type_name<T>();
+
+    // Shortened name of T, computed entirely at compile time
+    template <typename T>
+    inline constexpr std::string_view type_name_v = type_name_storage_v<T>.view();
+
+    // Demangles an RTTI name and shortens it like type_name_v
+    inline std::string demangle(const char * name) {
+#ifdef __GNUG__
+      int status = -4;
+      std::unique_ptr<char, void(*)(void*)> res {
+        abi::__cxa_demangle(name, NULL, NULL, &status),
+	  std::free
+	  };
+      std::string result = (status==0) ? res.get() : name;
+#else
+      std::string result = name;
+#endif
+      result.resize(shorten_type_name(result, result.data()));
+      return result;
+    }
+
+    // Process-wide cache of demangled type names, keyed by std::type_index.
+    // An open-addressed table of atomic pointers: readers only load, and a
+    // miss publishes a new entry with a single compare-and-swap. Entries are
+    // never removed (nor freed at exit, so printing from static destructors
+    // stays safe), which keeps the returned string_views valid for the
+    // lifetime of the process.
+    //
+    // The table holds `capacity` types. Once it is full, a lookup of any
+    // other type probes every slot and returns an empty view, and the
+    // printer falls back to demangling that type's name again on every
+    // print, which is slower but prints the same name. Types cached before
+    // that keep their fast lookup
+    class type_name_cache {
+    public:
+      static constexpr std::size_t capacity = 1024;
+
+      static type_name_cache& instance() {
+	static type_name_cache cache;
+	return cache;
+      }
+
+      // Returns the demangled name, or an empty view if the table is full
+      // and doesn't hold the type
+      std::string_view lookup(const std::type_info& type) {
+	const std::size_t hash = std::type_index(type).hash_code();
+	entry * created = nullptr;
+	for (std::size_t probe = 0; probe < capacity; probe++) {
+	  std::atomic<entry *>& slot = slots_[(hash + probe) & (capacity - 1)];
+	  entry * current = slot.load(std::memory_order_acquire);
+	  if (current == nullptr) {
+	    if (created == nullptr)
+	      created = new entry{std::type_index(type), demangle(type.name())};
+	    if (slot.compare_exchange_strong(current, created, std::memory_order_acq_rel,
+					     std::memory_order_acquire))
+	      return created->name;
+	    // Lost the race; current now holds the winner's entry
+	  }
+	  if (current->type == std::type_index(type)) {
+	    delete created;
+	    return current->name;
+	  }
 	}
-	if (value.size() == 0)
-	  print_internal_without_quotes("}", indent, "");
-	else if (is_container<Value>::value == false)
-	  print_internal_without_quotes("}", indent, "");
-	else
-	  print_internal_without_quotes(line_terminator_ + "}", indent, "");
-	print_internal_without_quotes(line_terminator_, 0, "");	
+	delete created;
+	return {};
       }
-      
-      else {
-	if (value.size() == 0) {
-	  print_internal_without_quotes("{", indent, "");
-	}
-	else if (value.size() == 1) {
-	  print_internal_without_quotes("{", indent, "");
-	  for (auto& kvpair : value) {
-	    print_internal(kvpair.first, 0, "", level + 1);
-	    print_internal_without_quotes(" : ", 0, "");
-	    print_internal(kvpair.second, 0, "", level + 1);
+
+    private:
+      struct entry {
+	std::type_index type;
+	std::string name;
+      };
+
+      static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+      type_name_cache() = default;
+
+      std::atomic<entry *> slots_[capacity] = {};
+    };
+
+    // Contiguous buffer that the printer formats into. Content is handed to
+    // the wrapped stream's streambuf in large blocks, either at the end of a
+    // top-level print or once flush_threshold bytes have accumulated.
+    // The buffer doubles as the put area of a std::streambuf, so values
+    // without a dedicated formatter (e.g., user-defined operator<<) are
+    // inserted into the same memory through a std::ostream
+    class output_buffer : public std::streambuf {
+    public:
+      static constexpr std::size_t initial_capacity = 1024;
+      static constexpr std::size_t flush_threshold = 64 * 1024;
+
+      // Output is handed to `sink` with `sink_mutex` locked. The lock is
+      // taken on the first hand-over and held until the buffer is
+      // destroyed, so the output of one buffer is never interleaved with
+      // the output of others that share the mutex
+      output_buffer(std::ostream& sink, std::recursive_mutex& sink_mutex) :
+	sink_(sink),
+	sink_lock_(sink_mutex, std::defer_lock) {
+	// Start from the memory of the last buffer on this thread
+	storage& spare = spare_storage();
+	data_ = std::move(spare.data);
+	capacity_ = spare.capacity;
+	spare.capacity = 0;
+	setp(data_.get(), data_.get() + capacity_);
+      }
+
+      output_buffer(const output_buffer&) = delete;
+      output_buffer& operator=(const output_buffer&) = delete;
+
+      // Print calls flush before they return, so that an error of the
+      // sink reaches the caller. What is still held here was written by a
+      // call that threw; it is handed over if possible, and an error doing
+      // so is dropped, as the stream state already records it
+      ~output_buffer() override {
+	try {
+	  flush();
+	}
+	catch (...) {
+	}
+	storage& spare = spare_storage();
+	if (capacity_ > spare.capacity) {
+	  spare.data = std::move(data_);
+	  spare.capacity = capacity_;
+	}
+      }
+
+      // Bytes held in the buffer
+      std::size_t size() const {
+	return static_cast<std::size_t>(pptr() - pbase());
+      }
+
+      // Bytes written since construction, whether flushed or not
+      std::size_t total() const {
+	return handed_over_ + size();
+      }
+
+      // Last byte written, or '\0' if there is none
+      char back() const {
+	return pptr() != pbase() ? pptr()[-1] : last_handed_over_;
+      }
+
+      void write(const char * data, std::size_t count) {
+	// An empty string_view may have a null data()
+	if (count == 0)
+	  return;
+	if (static_cast<std::size_t>(epptr() - pptr()) < count) {
+	  if (count >= flush_threshold) {
+	    // Too large to be worth copying; hand it over directly
+	    flush();
+	    write_to_sink(data, count);
+	    return;
 	  }
+	  make_room(count);
 	}
-	else if (value.size() > 0) {
-	  size_t count = 0;
-	  for (auto& kvpair : value) {
-	    if (count == 0) {
-	      print_internal_without_quotes("{", indent, "");
-	      print_internal(kvpair.first, 0, "", level + 1);
-	      print_internal_without_quotes(" : ", 0, "");
-	      print_internal(kvpair.second, 0, "", level + 1);
-	      print_internal_without_quotes(", ", 0, "");
-	    }
-	    else if (count + 1 < value.size()) {
-	      print_internal(kvpair.first, indent + indent_, "", level + 1);
-	      print_internal_without_quotes(" : ", 0, "");
-	      print_internal(kvpair.second, 0, "", level + 1);
-	      print_internal_without_quotes(", ", 0, "");
-	    }
-	    else {
-	      print_internal(kvpair.first, 0, "", level + 1);
-	      print_internal_without_quotes(" : ", 0, "");
-	      print_internal(kvpair.second, 0, "", level + 1);
-	    }
-	    count += 1;
-	  }	  
+	std::memcpy(pptr(), data, count);
+	pbump(static_cast<int>(count));
+      }
+
+      void write(std::string_view value) {
+	write(value.data(), value.size());
+      }
+
+      void write(char value) {
+	if (pptr() == epptr())
+	  make_room(1);
+	*pptr() = value;
+	pbump(1);
+      }
+
+      // Returns a pointer to at least `count` writable bytes; the bytes
+      // actually written are committed with commit()
+      char * reserve(std::size_t count) {
+	if (static_cast<std::size_t>(epptr() - pptr()) < count)
+	  make_room(count);
+	return pptr();
+      }
+
+      void commit(char * end) {
+	pbump(static_cast<int>(end - pptr()));
+      }
+
+      void flush() {
+	if (pptr() != pbase()) {
+	  write_to_sink(pbase(), size());
+	  setp(pbase(), epptr());
 	}
-	print_internal_without_quotes("}", 0, "");
-	if (level == 0 && compact_)
-	  print_internal_without_quotes(line_terminator_, 0, "");
       }
+
+    protected:
+      int_type overflow(int_type value) override {
+	if (!traits_type::eq_int_type(value, traits_type::eof()))
+	  write(traits_type::to_char_type(value));
+	return traits_type::not_eof(value);
+      }
+
+      std::streamsize xsputn(const char * data, std::streamsize count) override {
+	write(data, static_cast<std::size_t>(count));
+	return count;
+      }
+
+      int sync() override {
+	flush();
+	return 0;
+      }
+
+    private:
+      struct storage {
+	std::unique_ptr<char[]> data;
+	std::size_t capacity = 0;
+      };
+
+      // Memory kept for the next buffer on this thread, so that repeated
+      // print calls don't allocate
+      static storage& spare_storage() {
+	thread_local storage spare;
+	return spare;
+      }
+
+      void make_room(std::size_t count) {
+	if (size() + count > flush_threshold)
+	  flush();
+	if (static_cast<std::size_t>(epptr() - pptr()) >= count)
+	  return;
+	const std::size_t used = size();
+	const std::size_t capacity = (std::max)({used + count, 2 * capacity_, initial_capacity});
+	std::unique_ptr<char[]> data(new char[capacity]);
+	if (used > 0)
+	  std::memcpy(data.get(), pbase(), used);
+	data_ = std::move(data);
+	capacity_ = capacity;
+	setp(data_.get(), data_.get() + capacity_);
+	pbump(static_cast<int>(used));
+      }
+
+      void write_to_sink(const char * data, std::size_t count) {
+	if (!sink_lock_.owns_lock())
+	  sink_lock_.lock();
+	handed_over_ += count;
+	if (count > 0)
+	  last_handed_over_ = data[count - 1];
+	// Hand over like an unformatted insertion: the sentry flushes the
+	// tied stream first, skips a stream that is already in a failed
+	// state, and flushes a unitbuf stream once the block is written
+	const std::ostream::sentry sentry(sink_);
+	if (!sentry)
+	  return;
+	if (sink_.rdbuf()->sputn(data, static_cast<std::streamsize>(count)) != static_cast<std::streamsize>(count))
+	  sink_.setstate(std::ios_base::badbit);
+      }
+
+      std::ostream& sink_;
+      std::unique_lock<std::recursive_mutex> sink_lock_;
+      std::unique_ptr<char[]> data_;
+      std::size_t capacity_ = 0;
+      std::size_t handed_over_ = 0;
+      char last_handed_over_ = '\0';
+    };
+
+    class binary_decoder;
+
+  }
+
+  // A value whose type is only known at run time, such as one read back
+  // from a binary log. It prints exactly like the value it stands for: the
+  // kind picks the overload, and a container keeps the brackets, layout
+  // and truncation of the container it was made from
+  class DynamicValue {
+  public:
+    enum class Kind {
+      null,             // nullptr
+      boolean,
+      character,        // char
+      integer,          // Signed integer of width() bytes
+      unsigned_integer, // Unsigned integer of width() bytes
+      float32,          // float, printed with the f suffix
+      float64,          // double
+      extended,         // long double
+      string,           // Printed like std::string
+      text,             // Printed as is, e.g., the output of a formatter
+      wrapper,          // std::optional or std::variant: nullopt without an item, else the item
+      list,             // [a, b], one item per line at the top level
+      set,              // {a, b}, likewise
+      queue,            // [a, b], always inline
+      stack,            // [a, b], one item per line at the top level even when compact
+      tuple,            // (a, b)
+      map               // {k : v}, one entry per line at the top level
+    };
+
+    typedef std::vector<DynamicValue> items_type;
+    typedef std::vector<std::pair<DynamicValue, DynamicValue>> entries_type;
+
+    DynamicValue() = default;
+
+    static DynamicValue boolean(bool value) {
+      return DynamicValue(Kind::boolean, value);
+    }
+
+    static DynamicValue character(char value) {
+      return DynamicValue(Kind::character, value);
+    }
+
+    static DynamicValue integer(std::int64_t value, size_t width = sizeof(std::int64_t)) {
+      DynamicValue result(Kind::integer, value);
+      result.width_ = static_cast<unsigned char>(width);
+      return result;
+    }
+
+    static DynamicValue unsigned_integer(std::uint64_t value, size_t width = sizeof(std::uint64_t)) {
+      DynamicValue result(Kind::unsigned_integer, value);
+      result.width_ = static_cast<unsigned char>(width);
+      return result;
+    }
+
+    static DynamicValue floating(float value) {
+      return DynamicValue(Kind::float32, value);
+    }
+
+    static DynamicValue floating(double value) {
+      return DynamicValue(Kind::float64, value);
+    }
+
+    static DynamicValue floating(long double value) {
+      return DynamicValue(Kind::extended, value);
+    }
+
+    static DynamicValue string(std::string value) {
+      return DynamicValue(Kind::string, std::move(value));
+    }
+
+    static DynamicValue text(std::string value) {
+      return DynamicValue(Kind::text, std::move(value));
+    }
+
+    // An empty optional
+    static DynamicValue wrapper() {
+      return DynamicValue(Kind::wrapper, items_type());
+    }
+
+    static DynamicValue wrapper(DynamicValue value) {
+      items_type items;
+      items.push_back(std::move(value));
+      return DynamicValue(Kind::wrapper, std::move(items));
+    }
+
+    // A list, set, queue, stack or tuple. Ranges that can only be walked
+    // forward (e.g., unordered sets) are `forward_only`, which drops the
+    // tail that max_elements would keep
+    static DynamicValue sequence(Kind kind, items_type items, bool forward_only = false) {
+      DynamicValue result(kind, std::move(items));
+      result.forward_only_ = forward_only;
+      return result;
+    }
+
+    static DynamicValue map(entries_type entries, bool forward_only = false) {
+      DynamicValue result(Kind::map, std::move(entries));
+      result.forward_only_ = forward_only;
+      return result;
+    }
+
+    Kind kind() const {
+      return kind_;
+    }
+
+    size_t width() const {
+      return width_;
+    }
+
+    bool forward_only() const {
+      return forward_only_;
+    }
+
+    // The stored value: bool, char, std::int64_t, std::uint64_t, float,
+    // double, long double, std::string, items_type or entries_type
+    template <typename T>
+    const T& get() const {
+      return std::get<T>(value_);
+    }
+
+    const items_type& items() const {
+      return get<items_type>();
+    }
+
+    const entries_type& entries() const {
+      return get<entries_type>();
+    }
+
+  private:
+    friend class detail::binary_decoder;
+
+    template <typename T>
+    DynamicValue(Kind kind, T&& value) :
+      kind_(kind),
+      value_(std::forward<T>(value)) {}
+
+    // Makes this a value of `kind` stored as a T and returns the T. A T
+    // that is already stored is kept as it is, with its allocations, for
+    // the caller to overwrite
+    template <typename T>
+    T& reset(Kind kind, size_t width = 0, bool forward_only = false) {
+      kind_ = kind;
+      width_ = static_cast<unsigned char>(width);
+      forward_only_ = forward_only;
+      if (!std::holds_alternative<T>(value_))
+	value_.template emplace<T>();
+      return std::get<T>(value_);
+    }
+
+    Kind kind_ = Kind::null;
+    unsigned char width_ = 0; // Bytes of an integer, which num_put output depends on
+    bool forward_only_ = false;
+    std::variant<std::monostate, bool, char, std::int64_t, std::uint64_t, float, double, long double,
+		 std::string, items_type, entries_type> value_;
+  };
+
+  namespace detail {
+
+    // Elements that print as a bracketed sequence of their own. In an
+    // expanded sequence, the closing bracket then goes on its own line
+    // even after a single element. A map entry counts as its mapped value,
+    // and a dynamic value goes by its kind
+    template <typename T>
+    struct is_bracketed : std::bool_constant<is_container<T>::value && !std::is_same<T, std::string>::value> {};
+
+    template <typename T>
+    constexpr bool bracketed(const T&) {
+      return is_bracketed<T>::value;
+    }
+
+    inline bool bracketed(const DynamicValue& value) {
+      typedef DynamicValue::Kind Kind;
+      return value.kind() == Kind::list || value.kind() == Kind::set || value.kind() == Kind::map;
     }
 
     template <typename Key, typename Value>
-    void print_internal(std::pair<Key, Value> value, size_t indent = 0, const std::string& line_terminator = "\n",
-			size_t level = 0) {
-      print_internal_without_quotes("(", indent, "");
-      print_internal(value.first, 0, "");
-      print_internal_without_quotes(", ", 0, "");
-      print_internal(value.second, 0, "");
-      print_internal_without_quotes(")", 0, line_terminator, level);
+    bool bracketed(const key_value_ref<Key, Value>& entry) {
+      return bracketed(entry.value);
     }
 
-    template <class ...Ts>
-    void print_internal(std::variant<Ts...> value, size_t indent = 0,
-			const std::string& line_terminator = "\n", size_t level = 0) {
-      std::visit([=](const auto& value) { print_internal(value, indent, line_terminator, level); }, value);
+    // Hides all but the forward traversal of an iterator, so that a copy of
+    // a forward-only range is truncated like the range itself
+    template <typename Iterator>
+    struct forward_only_iterator {
+      typedef std::forward_iterator_tag iterator_category;
+      typedef typename std::iterator_traits<Iterator>::value_type value_type;
+      typedef typename std::iterator_traits<Iterator>::difference_type difference_type;
+      typedef typename std::iterator_traits<Iterator>::pointer pointer;
+      typedef typename std::iterator_traits<Iterator>::reference reference;
+
+      Iterator base;
+
+      reference operator*() const {
+	return *base;
+      }
+
+      pointer operator->() const {
+	return &*base;
+      }
+
+      forward_only_iterator& operator++() {
+	++base;
+	return *this;
+      }
+
+      forward_only_iterator operator++(int) {
+	return forward_only_iterator{base++};
+      }
+
+      bool operator==(const forward_only_iterator& other) const {
+	return base == other.base;
+      }
+
+      bool operator!=(const forward_only_iterator& other) const {
+	return base != other.base;
+      }
+    };
+
+    // Elements in a chunk of parallel formatting
+    inline constexpr size_t parallel_chunk = 16 * 1024;
+
+    // Threads that format the chunks of large containers in parallel.
+    // They are started on first use, as many as the largest request has
+    // asked for, and kept until the program exits. Callers take part in
+    // their own jobs, so several print calls can share the pool
+    class worker_pool {
+    public:
+      static worker_pool& instance() {
+	static worker_pool pool;
+	return pool;
+      }
+
+      worker_pool(const worker_pool&) = delete;
+      worker_pool& operator=(const worker_pool&) = delete;
+
+      ~worker_pool() {
+	{
+	  std::lock_guard<std::mutex> lock(mutex_);
+	  stop_ = true;
+	}
+	available_.notify_all();
+	for (std::thread& worker : workers_)
+	  worker.join();
+      }
+
+      // Runs task(i) for each i in [0, count) on up to `threads` threads,
+      // the calling one included, and returns once all of them have run.
+      // The first exception thrown by a task is rethrown here
+      template <typename Task>
+      void run(size_t count, size_t threads, const Task& task) {
+	job work;
+	work.count = count;
+	work.task = &task;
+	work.run = [](const void * task, size_t index) { (*static_cast<const Task *>(task))(index); };
+	const size_t helpers = (std::min)(threads, count) - 1;
+	if (helpers > 0) {
+	  std::lock_guard<std::mutex> lock(mutex_);
+	  while (workers_.size() < helpers)
+	    workers_.emplace_back([this] { serve(); });
+	  work.helpers = helpers;
+	  jobs_.push_back(&work);
+	}
+	available_.notify_all();
+	work.execute();
+
+	// No worker joins once the job is off the queue; wait for the ones
+	// that did
+	std::unique_lock<std::mutex> lock(mutex_);
+	const auto queued = std::find(jobs_.begin(), jobs_.end(), &work);
+	if (queued != jobs_.end())
+	  jobs_.erase(queued);
+	finished_.wait(lock, [&work] { return work.active == 0; });
+	if (work.error)
+	  std::rethrow_exception(work.error);
+      }
+
+    private:
+      struct job {
+	const void * task = nullptr;
+	void (*run)(const void *, size_t) = nullptr;
+	size_t count = 0;
+	size_t helpers = 0; // Workers that may still join, guarded by the pool's mutex
+	size_t active = 0;  // Workers running tasks of the job, guarded by the pool's mutex
+	std::atomic<size_t> next{0};
+	std::atomic<bool> failed{false};
+	std::exception_ptr error;
+
+	// Runs tasks until none are left to claim
+	void execute() {
+	  for (size_t index = next.fetch_add(1); index < count; index = next.fetch_add(1)) {
+	    try {
+	      run(task, index);
+	    }
+	    catch (...) {
+	      if (!failed.exchange(true))
+		error = std::current_exception();
+	    }
+	  }
+	}
+      };
+
+      worker_pool() = default;
+
+      // Loop of a worker: joins the oldest queued job until the pool stops
+      void serve() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;) {
+	  available_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+	  if (stop_)
+	    return;
+	  job * work = jobs_.front();
+	  if (--work->helpers == 0)
+	    jobs_.pop_front();
+	  work->active += 1;
+	  lock.unlock();
+	  work->execute();
+	  lock.lock();
+	  if (--work->active == 0)
+	    finished_.notify_all();
+	}
+      }
+
+      std::mutex mutex_;
+      std::condition_variable available_; // Signaled when a job is queued or the pool stops
+      std::condition_variable finished_;  // Signaled when the last worker leaves a job
+      std::deque<job *> jobs_; // Jobs that still take workers, oldest first
+      std::vector<std::thread> workers_;
+      bool stop_ = false;
+    };
+
+    // Layout settings of a printer: compile-time constants taken from the
+    // policy, or members set through the printer's setters
+    template <typename Policy, bool Configurable = Policy::configurable>
+    struct layout_settings {
+      static constexpr bool compact() { return Policy::compact; }
+      static constexpr bool quotes() { return Policy::quotes; }
+      static constexpr size_t indent() { return Policy::indent; }
+      static constexpr std::string_view line_terminator() { return Policy::line_terminator; }
+    };
+
+    template <typename Policy>
+    struct layout_settings<Policy, true> {
+      std::string line_terminator_ = "\n";
+      size_t indent_ = 2;
+      bool quotes_ = false;
+      bool compact_ = false;
+
+      bool compact() const { return compact_; }
+      bool quotes() const { return quotes_; }
+      size_t indent() const { return indent_; }
+      std::string_view line_terminator() const { return line_terminator_; }
+    };
+
+    // Settings of a printer. The printer publishes them as immutable
+    // snapshots, and each print call works with the one that was current
+    // when it started
+    template <typename Policy>
+    struct printer_config {
+      layout_settings<Policy> layout;
+      bool sort_initializer_lists = false;
+      FloatFormat float_format = FloatFormat::shortest;
+      int precision = 6;
+      size_t max_head = unlimited;
+      size_t max_tail = 0;
+      size_t max_depth = unlimited;
+      size_t max_string_length = unlimited;
+      size_t max_bytes = unlimited;
+      size_t parallel_threshold = unlimited;
+      size_t parallel_threads = 0;
+    };
+
+  }
+
+  // State of one print call, kept on the stack of the calling thread: the
+  // output buffer, the stream for operator<< and the byte budget, along
+  // with the snapshot of the printer's settings taken at the start of the
+  // call. Also handed to formatter<T>::format, to write text into the
+  // output as is or print a nested value with the printer's settings
+  template <typename Policy>
+  class basic_format_context {
+  public:
+    basic_format_context(const basic_format_context&) = delete;
+    basic_format_context& operator=(const basic_format_context&) = delete;
+
+    void write(std::string_view value) {
+      buffer_.write(value);
+    }
+
+    void write(char value) {
+      buffer_.write(value);
     }
 
     template <typename T>
-    void print_internal(std::optional<T> value, size_t indent = 0,
-			const std::string& line_terminator = "\n", size_t level = 0) {
-      if (value) {
-	print_internal(value.value(), indent, line_terminator, level);
+    void print(const T& value) {
+      print_internal(value, 0, "", format_level_ + 1);
+    }
+
+  private:
+    friend class BasicPrinter<Policy>;
+    friend class detail::binary_decoder;
+
+    std::ostream& stream_;
+    const detail::layout_settings<Policy>& layout_;
+    const bool sort_initializer_lists_;
+    const FloatFormat float_format_;
+    const int precision_;
+    const size_t max_head_;
+    const size_t max_tail_;
+    const size_t max_depth_;
+    const size_t max_string_length_;
+    const size_t parallel_threshold_;
+    const size_t parallel_threads_;
+    detail::output_buffer buffer_;
+    std::optional<std::ostream> format_; // Formats values without a fast path into buffer_, set up on first use
+    const bool plain_integers_; // Stream flags and locale allow the integer fast path
+    std::string type_name_; // Demangled names that did not fit in the type name cache
+    const size_t max_bytes_;
+    size_t budget_end_; // Buffer position where this call's byte budget runs out
+    bool budget_exhausted_ = false; // The budget marker has been written
+    size_t format_level_ = 0; // Nesting level of the value handed to a formatter
+
+    basic_format_context(std::ostream& stream, const detail::printer_config<Policy>& config,
+			 std::recursive_mutex& sink_mutex) :
+      stream_(stream),
+      layout_(config.layout),
+      sort_initializer_lists_(config.sort_initializer_lists),
+      float_format_(config.float_format),
+      precision_(config.precision),
+      max_head_(config.max_head),
+      max_tail_(config.max_tail),
+      max_depth_(config.max_depth),
+      max_string_length_(config.max_string_length),
+      parallel_threshold_(config.parallel_threshold),
+      parallel_threads_(config.parallel_threads),
+      buffer_(stream, sink_mutex),
+      plain_integers_(has_plain_integers(stream)),
+      max_bytes_(config.max_bytes),
+      budget_end_(config.max_bytes) {}
+
+    // Integers are formatted by hand unless the stream asks for a base,
+    // sign or digit grouping that only num_put knows about
+    static bool has_plain_integers(const std::ostream& stream) {
+      const auto integer_flags = std::ios_base::basefield | std::ios_base::showpos;
+      return ((stream.flags() & integer_flags) & ~std::ios_base::dec) == 0 &&
+	stream.getloc() == std::locale::classic();
+    }
+
+    // Prints the arguments of a print call, separated by an unquoted
+    // space. Only the last one is followed by the line terminator, and
+    // arguments after the one that spent the byte budget are skipped
+    template <typename T, typename... Targs>
+    void print_line(const T& value, const Targs&... Fargs) {
+      const std::string_view line_terminator = layout_.line_terminator();
+      if constexpr (sizeof...(Fargs) == 0) {
+	print_internal(value, 0, line_terminator, 0);
       }
       else {
-	print_internal_without_quotes("nullopt", indent, line_terminator, level);
+	print_internal(value, 0, "", 0);
+	std::size_t remaining = sizeof...(Fargs);
+	((budget_exhausted_ ? void() :
+	  (print_internal_without_quotes(" ", 0, ""),
+	   print_internal(Fargs, 0, --remaining == 0 ? line_terminator : "", 0))), ...);
+	// Containers end their line even when they are not the last argument
+	if (remaining > 0 && !line_terminator.empty() && buffer_.back() != line_terminator.back())
+	  write(line_terminator);
       }
     }
 
-    template <typename Container>
-    typename std::enable_if<is_specialization<Container, std::queue>::value, void>::type
-    print_internal(const Container& value, size_t indent = 0, const std::string& line_terminator = "\n",
-		   size_t level = 0) {
-      auto current_compact = compact_;
-      compact_ = true;
-      typedef typename Container::value_type T;
-      auto local = value;
-      std::vector<T> local_vector;
-      while (!local.empty()) {
-	local_vector.push_back(local.front());
-	local.pop();
+    template <typename T, typename... Targs>
+    void print_inline(const T& value, const Targs&... Fargs) {
+      print_internal(value, layout_.indent(), "", 0);
+      ((budget_exhausted_ ? void() :
+	(print_internal_without_quotes(" ", 0, ""), print_internal(Fargs, layout_.indent(), "", 0))), ...);
+    }
+
+    // print_line and print_inline for arguments that are only known at
+    // run time, such as those of a binary log record. Each call gets a
+    // byte budget of its own, so that a drain can print all of its
+    // records through one context
+    void print_arguments(const std::vector<DynamicValue>& values, bool is_inline) {
+      start_call();
+      if (values.empty())
+	return;
+      if (is_inline) {
+	print_internal(values[0], layout_.indent(), "", 0);
+	for (size_t i = 1; i < values.size() && !budget_exhausted_; i++) {
+	  print_internal_without_quotes(" ", 0, "");
+	  print_internal(values[i], layout_.indent(), "", 0);
+	}
+	return;
       }
-      print_internal(local_vector, indent, line_terminator, level);
-      compact_ = current_compact;
+      const std::string_view line_terminator = layout_.line_terminator();
+      if (values.size() == 1) {
+	print_internal(values[0], 0, line_terminator, 0);
+	return;
+      }
+      print_internal(values[0], 0, "", 0);
+      size_t remaining = values.size() - 1;
+      for (size_t i = 1; i < values.size() && !budget_exhausted_; i++) {
+	print_internal_without_quotes(" ", 0, "");
+	print_internal(values[i], 0, --remaining == 0 ? line_terminator : "", 0);
+      }
+      if (remaining > 0 && !line_terminator.empty() && buffer_.back() != line_terminator.back())
+	write(line_terminator);
     }
 
-    template <typename Container>
-    typename std::enable_if<is_specialization<Container, std::priority_queue>::value, void>::type
-    print_internal(const Container& value, size_t indent = 0, const std::string& line_terminator = "\n",
-		   size_t level = 0) {
-      auto current_compact = compact_;
-      compact_ = true;
-      typedef typename Container::value_type T;
-      auto local = value;
-      std::vector<T> local_vector;
-      while (!local.empty()) {
-	local_vector.push_back(local.top());
-	local.pop();
+    // Writes the whitespace buffer starting at `offset`, extended to `indent` spaces
+    void print_whitespace(size_t offset, size_t indent) {
+      size_t width = (std::min)(indent, detail::whitespace_width);
+      write(detail::whitespace.substr(offset, detail::indent_offset - offset + width));
+      for (indent -= width; indent > 0; indent -= width) {
+	width = (std::min)(indent, detail::whitespace_width);
+	write(detail::whitespace.substr(detail::indent_offset, width));
+      }
+    }
+
+    void print_indent(size_t indent) {
+      if (indent > 0)
+	print_whitespace(detail::indent_offset, indent);
+    }
+
+    // Indents, then hands out the formatting stream for values that are
+    // inserted with operator<<
+    std::ostream& indented(size_t indent) {
+      print_indent(indent);
+      return format_stream();
+    }
+
+    // The stream is set up with the formatting state of the wrapped stream
+    // when a value first needs it
+    std::ostream& format_stream() {
+      if (!format_) {
+	format_.emplace(&buffer_);
+	format_->flags(stream_.flags());
+	format_->precision(stream_.precision());
+	format_->fill(stream_.fill());
+	if (format_->getloc() != stream_.getloc())
+	  format_->imbue(stream_.getloc());
       }
-      print_internal(local_vector, indent, line_terminator, level);
-      compact_ = current_compact;
+      return *format_;
+    }
+
+    // ", \n" followed by the indentation of the next element
+    void print_delimiter(size_t indent) {
+      print_whitespace(detail::delimiter_offset, indent);
+    }
+
+    // "\n" followed by the indentation of the next element
+    void print_line_break(size_t indent) {
+      print_whitespace(detail::line_break_offset, indent);
     }
 
     template <typename T>
-    void print_internal(std::initializer_list<T> value, size_t indent = 0,
-			const std::string& line_terminator = "\n", size_t level = 0) {
-      std::multiset<T> local;
-      for(const T& x : value) {
-	local.insert(x);
+    typename std::enable_if<detail::is_integer<T>::value == true, void>::type
+    print_internal(T value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      print_indent(indent);
+      if constexpr (sizeof(T) <= sizeof(long long)) {
+	if (!plain_integers_) {
+	  // Promote so that 8-bit integers are printed as numbers too
+	  format_stream() << +value;
+	  write(line_terminator);
+	  return;
+	}
       }
-      print_internal(local, indent, line_terminator_, level);
+      char * first = buffer_.reserve(detail::max_integer_chars);
+      buffer_.commit(detail::format_integer(first, value));
+      write(line_terminator);
     }
 
-    template <typename Container>
-    typename std::enable_if<is_specialization<Container, std::stack>::value, void>::type
-    print_internal(const Container& value, size_t indent = 0, const std::string& line_terminator = "\n",
-		   size_t level = 0) {
-      bool current_compact = compact_;
-      compact_ = false; // Need to print a stack like its a stack, i.e., vertical
-      typedef typename Container::value_type T;
-      auto local = value;
-      std::vector<T> local_vector;
-      while (!local.empty()) {
-	local_vector.push_back(local.top());
-	local.pop();
+    template <typename T>
+    typename std::enable_if<std::is_null_pointer<T>::value == true, void>::type
+    print_internal(T value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      print_internal_without_quotes("nullptr", indent, line_terminator, level);
+    }
+
+    void print_internal(float value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      print_indent(indent);
+      print_floating(value);
+      write('f');
+      write(line_terminator);
+    }
+
+    void print_internal(double value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      print_indent(indent);
+      print_floating(value);
+      write(line_terminator);
+    }
+
+    void print_internal(long double value, size_t indent = 0, std::string_view line_terminator = "\n",
+			size_t level = 0) {
+      print_indent(indent);
+      print_floating(value);
+      write(line_terminator);
+    }
+
+    template <typename T>
+    void print_floating(T value) {
+      std::size_t capacity = detail::max_floating_chars<T>(float_format_, precision_);
+      for (;;) {
+	char * first = buffer_.reserve(capacity);
+	char * last = detail::format_floating(first, first + capacity, value, float_format_, precision_);
+	if (last != nullptr) {
+	  buffer_.commit(last);
+	  return;
+	}
+	capacity *= 2;
       }
-      print_internal(local_vector, indent, line_terminator, level);
-      compact_ = current_compact;
     }
 
-    template<class... Args>
-    void print_internal(const std::tuple<Args...>& value, size_t indent = 0, const std::string& line_terminator = "\n",
+    void print_internal(const std::string& value, size_t indent = 0, std::string_view line_terminator = "\n",
 			size_t level = 0) {
-      stream_ << std::string(indent, ' ') << value <<
-	line_terminator;	
+      print_string(value, indent, line_terminator);
+    }
+    
+    void print_internal(const char * value, size_t indent = 0, std::string_view line_terminator = "\n",
+			size_t level = 0) {
+      // A null C string has no characters to view
+      if (value == nullptr)
+	print_internal(nullptr, indent, line_terminator, level);
+      else
+	print_string(value, indent, line_terminator);
     }
 
-    template<typename T>
-    void print_internal(const std::complex<T>& value, size_t indent = 0, const std::string& line_terminator = "\n",
+    void print_internal(std::string_view value, size_t indent = 0, std::string_view line_terminator = "\n",
 			size_t level = 0) {
-      stream_ << std::string(indent, ' ') << "(" <<
-	value.real() << " + " << value.imag() << "i)" <<
-	line_terminator;	
+      print_string(value, indent, line_terminator);
     }
 
-    template<typename Pointer>
-    typename std::enable_if<is_specialization<Pointer, std::unique_ptr>::value ||
-			    is_specialization<Pointer, std::shared_ptr>::value ||
-			    is_specialization<Pointer, std::weak_ptr>::value, void>::type
-    print_internal(const Pointer& value, size_t indent = 0, const std::string& line_terminator = "\n",
-		   size_t level = 0) {
-      stream_ << std::string(indent, ' ') << "<" <<
-	type(value) <<
-	" at " << &value << ">" <<
-	line_terminator;	
+    // Prints a string value, quoted if requested and cut off after
+    // max_string_length_ bytes
+    void print_string(std::string_view value, size_t indent, std::string_view line_terminator) {
+      print_indent(indent);
+      if (layout_.quotes())
+	write('"');
+      const size_t budget = remaining_budget();
+      const bool cut_by_budget = budget < max_string_length_;
+      size_t length = (std::min)(max_string_length_, budget);
+      if (value.size() > length) {
+	// Don't split a UTF-8 sequence
+	while (length > 0 && (static_cast<unsigned char>(value[length]) & 0xC0) == 0x80)
+	  length -= 1;
+	write(value.substr(0, length));
+	if (!cut_by_budget)
+	  print_elided(value.size() - length);
+	else
+	  mark_budget_exhausted();
+      }
+      else {
+	write(value);
+      }
+      if (layout_.quotes())
+	write('"');
+      write(line_terminator);
     }
 
-  };
-  
+    void print_elided(size_t count) {
+      write(detail::elision_prefix);
+      char * first = buffer_.reserve(detail::max_integer_chars);
+      buffer_.commit(detail::format_integer(first, static_cast<std::uint64_t>(count)));
+      write(detail::elision_suffix);
+    }
+
+    // Starts the byte budget of another call at the current position
+    void start_call() {
+      const size_t total = buffer_.total();
+      budget_end_ = max_bytes_ > detail::unlimited - total ? detail::unlimited : total + max_bytes_;
+      budget_exhausted_ = false;
+    }
+
+    // Bytes left in this call's budget
+    size_t remaining_budget() const {
+      if (budget_end_ == detail::unlimited)
+	return detail::unlimited;
+      const size_t total = buffer_.total();
+      return total < budget_end_ ? budget_end_ - total : 0;
+    }
+
+    // Writes the budget marker, unless a nested value already has
+    void mark_budget_exhausted() {
+      if (!budget_exhausted_) {
+	budget_exhausted_ = true;
+	write(detail::budget_marker);
+      }
+    }
+
+    // Number of leading and trailing elements of a sequence of `size`
+    // elements at nesting `level` that are printed; the rest is elided
+    std::pair<size_t, size_t> visible_elements(size_t size, size_t level) const {
+      if (level >= max_depth_)
+	return {0, 0};
+      if (size > max_head_ && size - max_head_ > max_tail_)
+	return {max_head_, max_tail_};
+      return {size, 0};
+    }
+
+    void print_internal(char value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      if (!layout_.quotes())
+	print_internal_without_quotes(value, indent, line_terminator, level);
+      else
+	print_quoted(std::string_view(&value, 1), '\'', indent, line_terminator);
+    }    
+
+    void print_internal_without_quotes(std::string_view value, size_t indent = 0,
+				       std::string_view line_terminator = "\n", size_t level = 0) {
+      print_indent(indent);
+      write(value);
+      write(line_terminator);
+    }
+
+    void print_internal_without_quotes(char value, size_t indent = 0, std::string_view line_terminator = "\n",
+				       size_t level = 0) {
+      print_indent(indent);
+      write(value);
+      write(line_terminator);
+    }        
+
+    void print_quoted(std::string_view value, char quote, size_t indent, std::string_view line_terminator) {
+      print_indent(indent);
+      write(quote);
+      write(value);
+      write(quote);
+      write(line_terminator);
+    }
+    
+    void print_internal(bool value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      print_internal_without_quotes(value ? "true" : "false", indent, line_terminator, level);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_pointer<T>::value == true, void>::type
+    print_internal(T value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      if (value == nullptr) {
+	return print_internal(nullptr, indent, line_terminator, level);
+      }
+      indented(indent) << "<" << type(value) << " at "
+	      << value << ">";
+      write(line_terminator);
+    }
+
+    // Name of the type of t. Known at compile time, except for polymorphic
+    // objects with RTTI enabled, where the dynamic type is looked up in the
+    // process-wide cache. Past the capacity of the cache, the name of a
+    // type that isn't in it is demangled into scratch storage on every
+    // call, so a program that prints more polymorphic types than that pays
+    // a __cxa_demangle per print for the rest
+    template <class T>
+    std::string_view type(const T& t) {
+#if PPRINT_RTTI
+      if constexpr (std::is_polymorphic<T>::value || detail::type_name_v<T>.empty()) {
+	const std::type_info& info = typeid(t);
+	std::string_view name = detail::type_name_cache::instance().lookup(info);
+	if (name.empty()) {
+	  type_name_ = detail::demangle(info.name());
+	  name = type_name_;
+	}
+	return name;
+      }
+      else
+#endif
+	return detail::type_name_v<T>;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value == true, void>::type
+    print_internal(T value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      auto enum_string = magic_enum::enum_name(value);
+      if (enum_string.has_value()) {
+	print_internal_without_quotes(enum_string.value(), indent, line_terminator, level);
+      }
+      else {
+	indented(indent) << value;
+	write(line_terminator);
+      }
+    }
+
+    // Classes without a dedicated overload: through their formatter
+    // specialization, else their operator<<, else by type name
+    template <typename T>
+    typename std::enable_if<detail::is_object_category<T>::value, void>::type
+    print_internal(const T& value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      constexpr detail::category category = detail::category_v<T>;
+      if constexpr (category == detail::category::formatted) {
+	print_indent(indent);
+	const size_t outer_level = format_level_;
+	format_level_ = level;
+	formatter<T>().format(value, *this);
+	format_level_ = outer_level;
+	write(line_terminator);
+      }
+      else if constexpr (category == detail::category::streamable) {
+	indented(indent) << value
+		<< line_terminator;
+      }
+      else {
+	indented(indent) << "<Object " << type(value) << ">"
+		<< line_terminator;
+      }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_member_function_pointer<T>::value == true, void>::type
+    print_internal(T value, size_t indent = 0, std::string_view line_terminator = "\n", size_t level = 0) {
+      indented(indent) << "<Object.method " << type(value)
+	      << " at " << &value << ">"
+	      << line_terminator;
+    }
+
+    // Top-level sequences put each item on a line of its own
+    bool expands(size_t level) const {
+      return level == 0 && !layout_.compact();
+    }
+
+    // Prints a contiguous sequence of integers or floating-point values with
+    // the batch kernel. Returns false, without printing anything, for the
+    // cases that the generic sequence printer handles instead
+    template <typename T>
+    bool print_arithmetic(const T * data, size_t size, std::string_view brackets, size_t indent, size_t level) {
+      if constexpr (detail::is_integer<T>::value) {
+	if (!plain_integers_)
+	  return false;
+      }
+      if (size < 2 || visible_elements(size, level).first != size)
+	return false;
+      const bool expanded = expands(level);
+      const size_t element_indent = indent + layout_.indent();
+      if (expanded && element_indent > detail::whitespace_width)
+	return false;
+      const std::string_view delimiter = expanded ?
+	detail::whitespace.substr(detail::delimiter_offset, detail::indent_offset + element_indent) :
+	detail::separator;
+      // The kernel cannot stop halfway, so it only runs when even the worst
+      // case fits in the byte budget
+      const size_t budget = remaining_budget();
+      const size_t element_chars = max_arithmetic_chars<T>() + delimiter.size();
+      if (budget != detail::unlimited &&
+	  (budget < 2 * element_chars || (budget - 2 * element_chars) / element_chars < size))
+	return false;
+      if (expanded) {
+	write(brackets[0]);
+	print_line_break(element_indent);
+	print_arithmetic_elements(data, size, delimiter);
+	write('\n');
+	print_internal_without_quotes(brackets[1], indent, layout_.line_terminator());
+      }
+      else {
+	print_internal_without_quotes(brackets[0], indent, "");
+	print_arithmetic_elements(data, size, delimiter);
+	write(brackets[1]);
+	if (level == 0)
+	  write(layout_.line_terminator());
+      }
+      return true;
+    }
+
+    // Upper bound on the characters of one formatted element
+    template <typename T>
+    size_t max_arithmetic_chars() const {
+      if constexpr (std::is_floating_point<T>::value)
+	return detail::max_floating_chars<T>(float_format_, precision_) + (std::is_same<T, float>::value ? 1 : 0);
+      else
+	return detail::max_integer_chars;
+    }
+
+    // Batch kernel: converts a block of elements per buffer reservation
+    // into memory sized for the worst case, with the delimiters written
+    // inline and no per-element dispatch
+    template <typename T>
+    void print_arithmetic_elements(const T * data, size_t size, std::string_view delimiter) {
+      const size_t element_chars = max_arithmetic_chars<T>() + delimiter.size();
+      if (size >= parallel_threshold_ && size > detail::parallel_chunk) {
+	const size_t threads = parallel_threads_ != 0 ? parallel_threads_ : std::thread::hardware_concurrency();
+	if (threads > 1)
+	  return print_arithmetic_chunks(data, size, delimiter, element_chars, threads);
+      }
+
+      const size_t block = arithmetic_block(element_chars);
+      const T * last = data + size;
+      while (data != last) {
+	const T * block_last = data + (std::min)(block, static_cast<size_t>(last - data));
+	char * out = buffer_.reserve(element_chars * static_cast<size_t>(block_last - data));
+	buffer_.commit(format_arithmetic(out, data, block_last, last, delimiter, element_chars));
+	data = block_last;
+      }
+    }
+
+    static size_t arithmetic_block(size_t element_chars) {
+      return (std::max)(size_t{1}, detail::output_buffer::flush_threshold / 4 / element_chars);
+    }
+
+    // Formats [first, block_last) to `out`, each element followed by the
+    // delimiter unless it is the last one of the container. Only reads
+    // the settings, so the worker pool can run it for several chunks at once
+    template <typename T>
+    char * format_arithmetic(char * out, const T * first, const T * block_last, const T * last,
+			     std::string_view delimiter, size_t element_chars) const {
+      for (; first != block_last; ++first) {
+	if constexpr (std::is_floating_point<T>::value) {
+	  out = detail::format_floating(out, out + element_chars, *first, float_format_, precision_);
+	  if constexpr (std::is_same<T, float>::value)
+	    *out++ = 'f';
+	}
+	else {
+	  out = detail::format_integer(out, *first);
+	}
+	if (first + 1 != last) {
+	  std::memcpy(out, delimiter.data(), delimiter.size());
+	  out += delimiter.size();
+	}
+      }
+      return out;
+    }
+
+    // Formats the elements in rounds of two chunks per thread on the
+    // worker pool, each chunk into a buffer of its own, and writes the
+    // buffers of a round in order. The buffers are sized for the worst case
+    // of a chunk and reused from round to round, so memory stays bounded
+    // and pages once touched stay warm
+    template <typename T>
+    void print_arithmetic_chunks(const T * data, size_t size, std::string_view delimiter, size_t element_chars,
+				 size_t threads) {
+      const T * const last = data + size;
+      const size_t chunk_chars = element_chars * detail::parallel_chunk;
+      const size_t slots = (std::min)(2 * threads, (size + detail::parallel_chunk - 1) / detail::parallel_chunk);
+      std::vector<std::unique_ptr<char[]>> outputs(slots);
+      std::vector<size_t> lengths(slots);
+      for (std::unique_ptr<char[]>& output : outputs)
+	output.reset(new char[chunk_chars]);
+
+      while (data != last) {
+	const size_t remaining = static_cast<size_t>(last - data);
+	const size_t chunks = (std::min)(slots, (remaining + detail::parallel_chunk - 1) / detail::parallel_chunk);
+	detail::worker_pool::instance().run(chunks, threads, [&](size_t chunk) {
+	  const T * first = data + chunk * detail::parallel_chunk;
+	  const T * chunk_last = first + (std::min)(detail::parallel_chunk, static_cast<size_t>(last - first));
+	  char * const out = outputs[chunk].get();
+	  lengths[chunk] = static_cast<size_t>(format_arithmetic(out, first, chunk_last, last, delimiter,
+								 element_chars) - out);
+	});
+	for (size_t chunk = 0; chunk < chunks; chunk++)
+	  buffer_.write(outputs[chunk].get(), lengths[chunk]);
+	data += (std::min)(remaining, chunks * detail::parallel_chunk);
+      }
+    }
+
+    // Sequence and associative containers
+    template <typename Range>
+    typename std::enable_if<detail::category_v<Range> == detail::category::range ||
+			    detail::category_v<Range> == detail::category::map, void>::type
+    print_internal(const Range& value, size_t indent = 0, std::string_view line_terminator = "\n",
+		   size_t level = 0) {
+      typedef detail::range_traits<Range> traits;
+      if constexpr (traits::contiguous && detail::is_batch_arithmetic<typename Range::value_type>::value) {
+	if (print_arithmetic(value.data(), value.size(), traits::brackets, indent, level))
+	  return;
+      }
+      print_sequence(value.begin(), value.end(), value.size(), traits::brackets, indent, level, expands(level),
+		     typename traits::projection());
+    }
+
+    // Prints the `size` elements of [first, last) as a bracketed sequence,
+    // with one item per line if `expanded`. `project` maps an iterator to the element to print, so that views
+    // such as a sorted array of pointers can be printed without copying
+    // the elements they refer to. Elements cut by the truncation limits
+    // are never visited: random-access ranges jump over them and
+    // bidirectional ranges walk back from `last` to their tail
+    template <typename Iterator, typename Projection = detail::dereference>
+    void print_sequence(Iterator first, Iterator last, size_t size, std::string_view brackets, size_t indent,
+			size_t level, bool expanded, Projection project = Projection()) {
+      typedef typename std::iterator_traits<Iterator>::iterator_category category;
+      auto [head, tail] = visible_elements(size, level);
+      if constexpr (!std::is_base_of<std::bidirectional_iterator_tag, category>::value)
+	tail = 0;
+      const size_t elided = size - head - tail;
+      const size_t items = head + tail + (elided > 0 ? 1 : 0);
+
+      const size_t element_indent = indent + layout_.indent();
+      if (expanded) {
+	write(brackets[0]);
+	if (items > 1)
+	  print_line_break(element_indent);
+      }
+      else {
+	print_internal_without_quotes(brackets[0], indent, "");
+      }
+      const bool complete = print_items(first, last, head, elided, tail, level, project, expanded, element_indent);
+      if (expanded) {
+	if (items > 1 || (complete && size == 1 && detail::bracketed(project(first))))
+	  write('\n');
+	print_internal_without_quotes(brackets[1], indent, "");
+	write(layout_.line_terminator());
+      }
+      else {
+	write(brackets[1]);
+	if (level == 0)
+	  write(layout_.line_terminator());
+      }
+    }
+
+    // Prints the first `head` elements, the marker for the `elided`
+    // elements after them and the last `tail` elements. Items are
+    // separated by ", ", or in an expanded sequence by ",\n" and the
+    // indentation of the elements. Returns false if the byte budget ran
+    // out first
+    template <typename Iterator, typename Projection>
+    bool print_items(Iterator first, Iterator last, size_t head, size_t elided, size_t tail, size_t level,
+		     Projection project, bool expanded, size_t element_indent) {
+      for (size_t i = 0; i < head; i++, ++first) {
+	if (!within_budget(i > 0, expanded, element_indent))
+	  return false;
+	if (i > 0)
+	  print_item_delimiter(expanded, element_indent);
+	print_internal(project(first), 0, "", level + 1);
+      }
+      if (elided == 0)
+	return true;
+      if (!within_budget(head > 0, expanded, element_indent))
+	return false;
+      if (head > 0)
+	print_item_delimiter(expanded, element_indent);
+      print_elided(elided);
+      if (tail == 0)
+	return true;
+      typedef typename std::iterator_traits<Iterator>::iterator_category category;
+      if constexpr (std::is_base_of<std::random_access_iterator_tag, category>::value)
+	first += elided;
+      else
+	first = std::prev(last, tail);
+      for (size_t i = 0; i < tail; i++, ++first) {
+	if (!within_budget(true, expanded, element_indent))
+	  return false;
+	print_item_delimiter(expanded, element_indent);
+	print_internal(project(first), 0, "", level + 1);
+      }
+      return true;
+    }
+
+    void print_item_delimiter(bool expanded, size_t element_indent) {
+      if (expanded)
+	print_delimiter(element_indent);
+      else
+	write(detail::separator);
+    }
+
+    // Checks the byte budget before the next item of a sequence. When it
+    // has run out, the first sequence to notice writes the marker in place
+    // of the item, and the enclosing ones just close
+    bool within_budget(bool delimited, bool expanded, size_t element_indent) {
+      if (budget_end_ == detail::unlimited || buffer_.total() < budget_end_)
+	return true;
+      if (!budget_exhausted_) {
+	if (delimited)
+	  print_item_delimiter(expanded, element_indent);
+	mark_budget_exhausted();
+      }
+      return false;
+    }
+
+    template <typename Key, typename Value>
+    void print_internal(const detail::key_value_ref<Key, Value>& value, size_t indent = 0,
+			std::string_view line_terminator = "\n", size_t level = 0) {
+      print_internal(value.key, indent, "", level);
+      write(detail::key_value_separator);
+      print_internal(value.value, 0, line_terminator, level);
+    }
+
+    template <typename Key, typename Value>
+    void print_internal(const std::pair<Key, Value>& value, size_t indent = 0, std::string_view line_terminator = "\n",
+			size_t level = 0) {
+      print_internal_without_quotes("(", indent, "");
+      print_internal(value.first, 0, "", level + 1);
+      print_internal_without_quotes(detail::separator, 0, "");
+      print_internal(value.second, 0, "", level + 1);
+      print_internal_without_quotes(")", 0, line_terminator, level);
+    }
+
+    template <class ...Ts>
+    void print_internal(const std::variant<Ts...>& value, size_t indent = 0,
+			std::string_view line_terminator = "\n", size_t level = 0) {
+      std::visit([&](const auto& alternative) { print_internal(alternative, indent, line_terminator, level); }, value);
+    }
+
+    template <typename T>
+    void print_internal(const std::optional<T>& value, size_t indent = 0,
+			std::string_view line_terminator = "\n", size_t level = 0) {
+      if (value) {
+	print_internal(value.value(), indent, line_terminator, level);
+      }
+      else {
+	print_internal_without_quotes("nullopt", indent, line_terminator, level);
+      }
+    }
+
+    template <typename Container>
+    typename std::enable_if<is_specialization<Container, std::queue>::value, void>::type
+    print_internal(const Container& value, size_t indent = 0, std::string_view line_terminator = "\n",
+		   size_t level = 0) {
+      // Queues are always printed inline
+      const auto& container = detail::adaptor_access<Container>::container(value);
+      print_sequence(container.begin(), container.end(), container.size(), detail::square_brackets, indent,
+		     level, false);
+    }
+
+    template <typename Container>
+    typename std::enable_if<is_specialization<Container, std::priority_queue>::value, void>::type
+    print_internal(const Container& value, size_t indent = 0, std::string_view line_terminator = "\n",
+		   size_t level = 0) {
+      typedef typename Container::value_type T;
+      // Print in pop order by sorting pointers into the heap rather than
+      // draining a copy of it
+      const auto& heap = detail::adaptor_access<Container>::container(value);
+      const auto& compare = detail::adaptor_access<Container>::compare(value);
+      std::vector<const T *> order;
+      order.reserve(heap.size());
+      for (const T& element : heap) {
+	order.push_back(&element);
+      }
+      auto pops_first = [&compare](const T * lhs, const T * rhs) {
+	return compare(*rhs, *lhs);
+      };
+      // Only the printed elements need to be in order
+      const auto [head, tail] = visible_elements(order.size(), level);
+      if (head + tail == order.size()) {
+	std::sort(order.begin(), order.end(), pops_first);
+      }
+      else {
+	const auto tail_first = order.end() - static_cast<std::ptrdiff_t>(tail);
+	std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(head), order.end(), pops_first);
+	if (tail > 0) {
+	  std::nth_element(order.begin() + static_cast<std::ptrdiff_t>(head), tail_first, order.end(), pops_first);
+	  std::sort(tail_first, order.end(), pops_first);
+	}
+      }
+      print_sequence(order.begin(), order.end(), order.size(), detail::square_brackets, indent, level, false,
+		     detail::dereference_twice());
+    }
+
+    // Like the other containers, a list at level 0 ends its line with the
+    // printer's line terminator, so the line_terminator argument is unused
+    template <typename T>
+    void print_internal(std::initializer_list<T> value, size_t indent = 0,
+			std::string_view /* line_terminator */ = "\n", size_t level = 0) {
+      if constexpr (detail::is_less_comparable<T>::value) {
+	if (sort_initializer_lists_) {
+	  // Sort pointers to the elements; equal elements keep their order
+	  std::vector<const T *> order;
+	  order.reserve(value.size());
+	  for (const T& element : value) {
+	    order.push_back(&element);
+	  }
+	  std::stable_sort(order.begin(), order.end(), [](const T * lhs, const T * rhs) {
+	    return *lhs < *rhs;
+	  });
+	  print_sequence(order.begin(), order.end(), order.size(), detail::curly_brackets, indent, level,
+			 expands(level), detail::dereference_twice());
+	  return;
+	}
+      }
+      if constexpr (detail::is_batch_arithmetic<T>::value) {
+	if (print_arithmetic(value.begin(), value.size(), detail::curly_brackets, indent, level))
+	  return;
+      }
+      print_sequence(value.begin(), value.end(), value.size(), detail::curly_brackets, indent, level,
+		     expands(level));
+    }
+
+    template <typename Container>
+    typename std::enable_if<is_specialization<Container, std::stack>::value, void>::type
+    print_internal(const Container& value, size_t indent = 0, std::string_view line_terminator = "\n",
+		   size_t level = 0) {
+      // Need to print a stack like its a stack, i.e., vertical, with the
+      // top of the stack first
+      const auto& container = detail::adaptor_access<Container>::container(value);
+      print_sequence(container.rbegin(), container.rend(), container.size(), detail::square_brackets, indent,
+		     level, level == 0);
+    }
+
+    template<class... Args>
+    void print_internal(const std::tuple<Args...>& value, size_t indent = 0, std::string_view line_terminator = "\n",
+			size_t level = 0) {
+      print_internal_without_quotes("(", indent, "");
+      print_tuple_elements(value, level, std::index_sequence_for<Args...>());
+      print_internal_without_quotes(")", 0, line_terminator, level);
+    }
+
+    template<class Tuple, size_t... Is>
+    void print_tuple_elements(const Tuple& value, size_t level, std::index_sequence<Is...>) {
+      ((Is == 0 ? void() : print_internal_without_quotes(detail::separator, 0, ""),
+	print_internal(std::get<Is>(value), 0, "", level + 1)), ...);
+    }
+
+    template<typename T>
+    void print_internal(const std::complex<T>& value, size_t indent = 0, std::string_view line_terminator = "\n",
+			size_t level = 0) {
+      if constexpr (std::is_floating_point<T>::value) {
+	print_indent(indent);
+	write('(');
+	print_floating(value.real());
+	write(" + ");
+	print_floating(value.imag());
+	write("i)");
+      }
+      else {
+	indented(indent) << "(" << value.real() << " + " << value.imag() << "i)";
+      }
+      write(line_terminator);
+    }
+
+    template<typename Pointer>
+    typename std::enable_if<is_specialization<Pointer, std::unique_ptr>::value ||
+			    is_specialization<Pointer, std::shared_ptr>::value ||
+			    is_specialization<Pointer, std::weak_ptr>::value, void>::type
+    print_internal(const Pointer& value, size_t indent = 0, std::string_view line_terminator = "\n",
+		   size_t level = 0) {
+      indented(indent) << "<" <<
+	type(value) <<
+	" at " << &value << ">" <<
+	line_terminator;	
+    }
+
+    void print_internal(const DynamicValue& value, size_t indent = 0, std::string_view line_terminator = "\n",
+			size_t level = 0) {
+      typedef DynamicValue::Kind Kind;
+      switch (value.kind()) {
+      case Kind::null:
+	return print_internal(nullptr, indent, line_terminator, level);
+      case Kind::boolean:
+	return print_internal(value.get<bool>(), indent, line_terminator, level);
+      case Kind::character:
+	return print_internal(value.get<char>(), indent, line_terminator, level);
+      case Kind::integer:
+	return print_integer_of_width(value.get<std::int64_t>(), value.width(), indent, line_terminator, level);
+      case Kind::unsigned_integer:
+	return print_integer_of_width(value.get<std::uint64_t>(), value.width(), indent, line_terminator, level);
+      case Kind::float32:
+	return print_internal(value.get<float>(), indent, line_terminator, level);
+      case Kind::float64:
+	return print_internal(value.get<double>(), indent, line_terminator, level);
+      case Kind::extended:
+	return print_internal(value.get<long double>(), indent, line_terminator, level);
+      case Kind::string:
+	return print_string(value.get<std::string>(), indent, line_terminator);
+      case Kind::text:
+	return print_internal_without_quotes(value.get<std::string>(), indent, line_terminator, level);
+      case Kind::wrapper:
+	if (value.items().empty())
+	  return print_internal_without_quotes("nullopt", indent, line_terminator, level);
+	return print_internal(value.items().front(), indent, line_terminator, level);
+      case Kind::list:
+	return print_dynamic_sequence(value, value.items(), detail::square_brackets, indent, level, expands(level));
+      case Kind::set:
+	return print_dynamic_sequence(value, value.items(), detail::curly_brackets, indent, level, expands(level));
+      case Kind::queue:
+	return print_dynamic_sequence(value, value.items(), detail::square_brackets, indent, level, false);
+      case Kind::stack:
+	return print_dynamic_sequence(value, value.items(), detail::square_brackets, indent, level, level == 0);
+      case Kind::map:
+	return print_dynamic_sequence(value, value.entries(), detail::curly_brackets, indent, level, expands(level),
+				      detail::key_value());
+      case Kind::tuple:
+	print_internal_without_quotes("(", indent, "");
+	for (size_t i = 0; i < value.items().size(); i++) {
+	  if (i > 0)
+	    print_internal_without_quotes(detail::separator, 0, "");
+	  print_internal(value.items()[i], 0, "", level + 1);
+	}
+	return print_internal_without_quotes(")", 0, line_terminator, level);
+      }
+    }
+
+    // Integers go through the overload of their original type, since
+    // stream flags such as showpos or hex depend on it
+    template <typename T>
+    void print_integer_of_width(T value, size_t width, size_t indent, std::string_view line_terminator,
+				size_t level) {
+      constexpr bool is_signed = std::is_signed<T>::value;
+      switch (width) {
+      case 1:
+	return print_internal(static_cast<std::conditional_t<is_signed, std::int8_t, std::uint8_t>>(value),
+			      indent, line_terminator, level);
+      case 2:
+	return print_internal(static_cast<std::conditional_t<is_signed, std::int16_t, std::uint16_t>>(value),
+			      indent, line_terminator, level);
+      case 4:
+	return print_internal(static_cast<std::conditional_t<is_signed, std::int32_t, std::uint32_t>>(value),
+			      indent, line_terminator, level);
+      default:
+	return print_internal(value, indent, line_terminator, level);
+      }
+    }
+
+    template <typename Elements, typename Projection = detail::dereference>
+    void print_dynamic_sequence(const DynamicValue& value, const Elements& elements, std::string_view brackets,
+				size_t indent, size_t level, bool expanded, Projection project = Projection()) {
+      if (value.forward_only()) {
+	typedef detail::forward_only_iterator<typename Elements::const_iterator> iterator;
+	print_sequence(iterator{elements.begin()}, iterator{elements.end()}, elements.size(), brackets, indent, level,
+		       expanded, project);
+      }
+      else {
+	print_sequence(elements.begin(), elements.end(), elements.size(), brackets, indent, level, expanded,
+		       project);
+      }
+    }
+
+  };
+
+  template <typename Policy>
+  class BasicBinaryLogger;
+
+  template <typename Policy>
+  class BasicRecordStream;
+
+  namespace detail {
+    class json_writer;
+    class cbor_writer;
+  }
+
+  // Prints values with the layout settings of Policy: RuntimePolicy for a
+  // printer configured through its setters (PrettyPrinter), or a
+  // StaticPolicy whose settings are compile-time constants.
+  //
+  // Printing doesn't modify the printer, so one printer can be used from
+  // several threads at once. The setters publish a new snapshot of the
+  // settings, which the print calls that start after it pick up. The
+  // output of each print call reaches the stream in one piece
+  template <typename Policy>
+  class BasicPrinter {
+  private:
+    typedef detail::printer_config<Policy> config_type;
+
+    std::ostream& stream_;
+    std::shared_ptr<const config_type> config_; // Replaced as a whole, read and written atomically
+    std::mutex config_mutex_; // Serializes the setters
+    mutable std::recursive_mutex sink_mutex_; // Held while a print call hands its output to stream_
+
+  public:
+
+    BasicPrinter(std::ostream& stream = std::cout) :
+      stream_(stream),
+      config_(std::make_shared<const config_type>()) {}
+
+    BasicPrinter(const BasicPrinter& other) :
+      stream_(other.stream_),
+      config_(std::atomic_load(&other.config_)) {}
+
+    // The layout setters are only available with RuntimePolicy; a
+    // StaticPolicy fixes these settings at compile time
+    BasicPrinter& line_terminator(std::string_view value) {
+      static_assert(Policy::configurable, "line_terminator is fixed by the printer's policy");
+      return configure([&](config_type& config) { config.layout.line_terminator_ = value; });
+    }
+
+    BasicPrinter& indent(size_t indent) {
+      static_assert(Policy::configurable, "indent is fixed by the printer's policy");
+      return configure([&](config_type& config) { config.layout.indent_ = indent; });
+    }
+
+    BasicPrinter& compact(bool value) {
+      static_assert(Policy::configurable, "compact is fixed by the printer's policy");
+      return configure([&](config_type& config) { config.layout.compact_ = value; });
+    }
+
+    BasicPrinter& quotes(bool value) {
+      static_assert(Policy::configurable, "quotes is fixed by the printer's policy");
+      return configure([&](config_type& config) { config.layout.quotes_ = value; });
+    }
+
+    // Print braced initializer lists in ascending order instead of as given
+    BasicPrinter& sort_initializer_lists(bool value) {
+      return configure([&](config_type& config) { config.sort_initializer_lists = value; });
+    }
+
+    BasicPrinter& float_format(FloatFormat value) {
+      return configure([&](config_type& config) { config.float_format = value; });
+    }
+
+    // Digits used by the general, fixed and scientific float formats
+    BasicPrinter& precision(int value) {
+      return configure([&](config_type& config) { config.precision = (std::max)(value, 0); });
+    }
+
+    // Containers with more than head + tail elements print their first
+    // `head` and last `tail` elements around a "... (k more)" marker.
+    // Ranges that can only be walked forward (e.g., unordered maps) print
+    // their head only
+    BasicPrinter& max_elements(size_t head, size_t tail = 0) {
+      return configure([&](config_type& config) {
+	config.max_head = head;
+	config.max_tail = tail;
+      });
+    }
+
+    // Containers nested more than `value` levels deep print as "[... (k more)]"
+    BasicPrinter& max_depth(size_t value) {
+      return configure([&](config_type& config) { config.max_depth = value; });
+    }
+
+    // Strings longer than `value` bytes are cut off with a "... (k more)"
+    // marker, at a UTF-8 character boundary
+    BasicPrinter& max_string_length(size_t value) {
+      return configure([&](config_type& config) { config.max_string_length = value; });
+    }
+
+    // Caps the output of each print call at about `value` bytes. Once the
+    // budget is spent, the printer stops before the next element, writes a
+    // single "..." marker and only closes the brackets that are still open
+    BasicPrinter& max_bytes(size_t value) {
+      return configure([&](config_type& config) { config.max_bytes = value; });
+    }
+
+    // Contiguous containers of at least `threshold` numbers are formatted
+    // in chunks on a pool of `threads` threads, the calling one included
+    // (0 for one per hardware thread), each chunk into a buffer of its own.
+    // The buffers are written in order, so the output is the same as on
+    // the calling thread alone, which is the default
+    BasicPrinter& parallel(size_t threshold, size_t threads = 0) {
+      return configure([&](config_type& config) {
+	config.parallel_threshold = threshold;
+	config.parallel_threads = threads;
+      });
+    }
+
+    template <typename T>
+    void print(T&& value) const {
+      with_context([&](context_type& context) { context.print_line(value); });
+    }
+
+    template <typename T>
+    void print(std::initializer_list<T> value) const {
+      with_context([&](context_type& context) { context.print_line(value); });
+    }
+
+    template<typename T, typename... Targs>
+    void print(T&& value, Targs&&... Fargs) const {
+      with_context([&](context_type& context) { context.print_line(value, Fargs...); });
+    }
+
+    template <typename T>
+    void print_inline(T&& value) const {
+      with_context([&](context_type& context) { context.print_inline(value); });
+    }
+
+    template <typename T>
+    void print_inline(std::initializer_list<T> value) const {
+      with_context([&](context_type& context) { context.print_inline(value); });
+    }
+
+    template<typename T, typename... Targs>
+    void print_inline(T&& value, Targs&&... Fargs) const {
+      with_context([&](context_type& context) { context.print_inline(value, Fargs...); });
+    }
+
+  private:
+    template <typename> friend class BasicBinaryLogger;
+    template <typename> friend class BasicRecordStream;
+    friend class detail::binary_decoder;
+    friend class detail::json_writer;
+    friend class detail::cbor_writer;
+
+    typedef basic_format_context<Policy> context_type;
+
+    // Copies the current settings, lets `update` change the copy and
+    // publishes it
+    template <typename Update>
+    BasicPrinter& configure(Update update) {
+      std::lock_guard<std::mutex> lock(config_mutex_);
+      std::shared_ptr<config_type> config = std::make_shared<config_type>(*std::atomic_load(&config_));
+      update(*config);
+      std::atomic_store(&config_, std::shared_ptr<const config_type>(std::move(config)));
+      return *this;
+    }
+
+    // Runs `print` with a context of its own, which holds on to the
+    // settings that are current now until the call is done
+    template <typename Print>
+    void with_context(Print print) const {
+      const std::shared_ptr<const config_type> config = std::atomic_load(&config_);
+      context_type context(stream_, *config, sink_mutex_);
+      print(context);
+      context.buffer_.flush();
+    }
+
+    // Prints the arguments of a print or print_inline call read back from
+    // a binary log
+    void print_arguments(const std::vector<DynamicValue>& values, bool is_inline) const {
+      with_context([&](context_type& context) { context.print_arguments(values, is_inline); });
+    }
+
+    // Returns `value` as it prints nested in another value, with the
+    // current settings and the formatting state of the stream
+    template <typename T>
+    std::string format_nested(const T& value) const {
+      thread_local std::ostringstream scratch;
+      scratch.str(std::string());
+      scratch.flags(stream_.flags());
+      scratch.precision(stream_.precision());
+      scratch.fill(stream_.fill());
+      if (scratch.getloc() != stream_.getloc())
+	scratch.imbue(stream_.getloc());
+      {
+	const std::shared_ptr<const config_type> config = std::atomic_load(&config_);
+	std::recursive_mutex scratch_mutex;
+	context_type context(scratch, *config, scratch_mutex);
+	context.print_internal(value, 0, "", 1);
+	context.buffer_.flush();
+      }
+      return scratch.str();
+    }
+
+  };
+
+  // What BasicAsyncPrinter::print does when its queue is full
+  enum class OverflowPolicy {
+    block,  // Wait for the formatter thread to make room
+    drop,   // Discard the message
+    sample  // Wait for room for one in `sample_rate` messages, discard the others
+  };
+
+  namespace detail {
+
+    // Copy of a print argument that stays valid after the call returns.
+    // C strings and string views are copied into a string; a null C string
+    // is kept as nullptr so that it prints the same
+    template <typename T>
+    std::decay_t<T> capture(T&& value) {
+      return std::forward<T>(value);
+    }
+
+    inline std::string capture(std::string_view value) {
+      return std::string(value);
+    }
+
+    inline std::variant<std::nullptr_t, std::string> capture(const char * value) {
+      if (value == nullptr)
+	return nullptr;
+      return std::string(value);
+    }
+
+    inline std::variant<std::nullptr_t, std::string> capture(char * value) {
+      return capture(static_cast<const char *>(value));
+    }
+
+    template <typename T>
+    using capture_t = decltype(capture(std::declval<T>()));
+
+    // The captured arguments of one print or print_inline call
+    template <typename Printer, bool Inline, typename... Ts>
+    struct async_message {
+      std::tuple<Ts...> values;
+
+      void operator()(const Printer& printer) const {
+	std::apply([&printer](const Ts&... values) {
+	  if constexpr (Inline)
+	    printer.print_inline(values...);
+	  else
+	    printer.print(values...);
+	}, values);
+      }
+    };
+
+    // Bounded queue of type-erased messages for many producers and one
+    // consumer, after Vyukov's bounded MPMC queue. A slot's sequence
+    // number tells whose turn it is: equal to the position, the slot is
+    // free for the producer that claims that position; one past it, the
+    // message is ready for the consumer. Messages are built in the slot,
+    // or on the heap if they don't fit
+    template <typename Printer>
+    class message_queue {
+    public:
+      explicit message_queue(size_t capacity) {
+	size_t size = 2;
+	while (size < capacity)
+	  size *= 2;
+	slots_.reset(new slot[size]);
+	mask_ = size - 1;
+	for (size_t i = 0; i < size; i++)
+	  slots_[i].sequence.store(i, std::memory_order_relaxed);
+      }
+
+      // Producer side: builds the Message returned by `make` in a free
+      // slot. Returns false, without calling `make`, if the queue is full
+      template <typename Message, typename Make>
+      bool try_push(Make&& make) {
+	size_t position = enqueue_position_.load(std::memory_order_relaxed);
+	slot * target;
+	for (;;) {
+	  target = &slots_[position & mask_];
+	  const size_t sequence = target->sequence.load(std::memory_order_acquire);
+	  const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - position);
+	  if (difference == 0) {
+	    if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+	      break;
+	  }
+	  else if (difference < 0) {
+	    return false;
+	  }
+	  else {
+	    position = enqueue_position_.load(std::memory_order_relaxed);
+	  }
+	}
+	// The position is taken, so the slot is published even if building
+	// the message throws, with a message that prints nothing
+	try {
+	  if constexpr (sizeof(Message) <= inline_size && alignof(Message) <= alignof(std::max_align_t)) {
+	    ::new (static_cast<void *>(target->storage)) Message(make());
+	    target->run = &run<Message, false>;
+	  }
+	  else {
+	    ::new (static_cast<void *>(target->storage)) Message *(new Message(make()));
+	    target->run = &run<Message, true>;
+	  }
+	}
+	catch (...) {
+	  target->run = &skip;
+	  target->sequence.store(position + 1, std::memory_order_release);
+	  throw;
+	}
+	target->sequence.store(position + 1, std::memory_order_release);
+	return true;
+      }
+
+      // Consumer side: prints and destroys the oldest message, if there is
+      // one ready. Its slot is handed back once it has been printed
+      bool pop(const Printer& printer) {
+	slot& source = slots_[dequeue_position_ & mask_];
+	if (source.sequence.load(std::memory_order_acquire) != dequeue_position_ + 1)
+	  return false;
+	// Hand the slot back even if printing throws
+	struct release {
+	  message_queue& queue;
+	  slot& source;
+	  ~release() {
+	    source.sequence.store(queue.dequeue_position_ + queue.mask_ + 1, std::memory_order_release);
+	    queue.dequeue_position_ += 1;
+	  }
+	} guard{*this, source};
+	source.run(source.storage, printer);
+	return true;
+      }
+
+      // Consumer side
+      bool empty() const {
+	return slots_[dequeue_position_ & mask_].sequence.load(std::memory_order_acquire) != dequeue_position_ + 1;
+      }
+
+      // Number of messages pushed so far, including those still being built
+      size_t pushed() const {
+	return enqueue_position_.load(std::memory_order_acquire);
+      }
+
+    private:
+      static constexpr size_t inline_size = 112;
+
+      struct alignas(64) slot {
+	std::atomic<size_t> sequence;
+	void (*run)(void * storage, const Printer& printer);
+	alignas(std::max_align_t) unsigned char storage[inline_size];
+      };
+
+      static void skip(void *, const Printer&) {}
+
+      template <typename Message, bool Boxed>
+      static void run(void * storage, const Printer& printer) {
+	Message * message;
+	if constexpr (Boxed)
+	  message = *std::launder(reinterpret_cast<Message **>(storage));
+	else
+	  message = std::launder(reinterpret_cast<Message *>(storage));
+	struct destroy {
+	  Message * message;
+	  ~destroy() {
+	    if constexpr (Boxed)
+	      delete message;
+	    else
+	      message->~Message();
+	  }
+	} guard{message};
+	(*message)(printer);
+      }
+
+      std::unique_ptr<slot[]> slots_;
+      size_t mask_;
+      alignas(64) std::atomic<size_t> enqueue_position_{0};
+      alignas(64) size_t dequeue_position_ = 0;
+    };
+
+  }
+
+  // Prints through a BasicPrinter on a background thread. print and
+  // print_inline capture a copy of their arguments (moving from rvalues)
+  // into a bounded lock-free queue and return; the formatter thread prints
+  // the messages in the order they were queued, with the settings the
+  // printer has at that time. The printer must outlive this object, which
+  // prints the messages still queued when it is destroyed
+  template <typename Policy>
+  class BasicAsyncPrinter {
+  public:
+    typedef BasicPrinter<Policy> printer_type;
+
+    explicit BasicAsyncPrinter(const printer_type& printer, size_t capacity = 1024,
+			       OverflowPolicy overflow = OverflowPolicy::block, size_t sample_rate = 16) :
+      printer_(printer),
+      overflow_(overflow),
+      sample_rate_((std::max)(sample_rate, size_t{1})),
+      queue_(capacity),
+      thread_([this] { consume(); }) {}
+
+    BasicAsyncPrinter(const BasicAsyncPrinter&) = delete;
+    BasicAsyncPrinter& operator=(const BasicAsyncPrinter&) = delete;
+
+    ~BasicAsyncPrinter() {
+      {
+	std::lock_guard<std::mutex> lock(mutex_);
+	stopping_ = true;
+      }
+      wake_.notify_one();
+      thread_.join();
+    }
+
+    template <typename... Targs>
+    void print(Targs&&... Fargs) {
+      push<false>(std::forward<Targs>(Fargs)...);
+    }
+
+    template <typename... Targs>
+    void print_inline(Targs&&... Fargs) {
+      push<true>(std::forward<Targs>(Fargs)...);
+    }
+
+    // Waits until the messages queued before the call have been printed
+    void flush() {
+      const size_t target = queue_.pushed();
+      std::unique_lock<std::mutex> lock(mutex_);
+      flush_waiters_.fetch_add(1);
+      drained_.wait(lock, [&] { return processed_.load() >= target; });
+      flush_waiters_.fetch_sub(1);
+    }
+
+    // Messages discarded because the queue was full
+    size_t dropped() const {
+      return dropped_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    template <bool Inline, typename... Targs>
+    void push(Targs&&... Fargs) {
+      typedef detail::async_message<printer_type, Inline, detail::capture_t<Targs>...> message;
+      auto make = [&] {
+	return message{std::tuple<detail::capture_t<Targs>...>(detail::capture(std::forward<Targs>(Fargs))...)};
+      };
+      auto try_push = [&] {
+	try {
+	  return queue_.template try_push<message>(make);
+	}
+	catch (...) {
+	  // The slot was published all the same
+	  wake();
+	  throw;
+	}
+      };
+      if (!try_push()) {
+	if (overflow_ == OverflowPolicy::drop ||
+	    (overflow_ == OverflowPolicy::sample &&
+	     (overflows_.fetch_add(1, std::memory_order_relaxed) + 1) % sample_rate_ != 0)) {
+	  dropped_.fetch_add(1, std::memory_order_relaxed);
+	  return;
+	}
+	while (!try_push())
+	  std::this_thread::yield();
+      }
+      wake();
+    }
+
+    // Wakes the formatter thread after a message was pushed, if it sleeps.
+    // Pairs with the fence in consume(): either this thread sees that the
+    // formatter thread is going to sleep, or that thread sees the message
+    void wake() {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (sleeping_.load(std::memory_order_relaxed)) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	wake_.notify_one();
+      }
+    }
+
+    void consume() {
+      for (;;) {
+	bool printed;
+	try {
+	  printed = queue_.pop(printer_);
+	}
+	catch (...) {
+	  // A message that fails to print is skipped
+	  printed = true;
+	}
+	if (printed) {
+	  processed_.fetch_add(1);
+	  if (flush_waiters_.load() > 0) {
+	    std::lock_guard<std::mutex> lock(mutex_);
+	    drained_.notify_all();
+	  }
+	  continue;
+	}
+	std::unique_lock<std::mutex> lock(mutex_);
+	sleeping_.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	wake_.wait(lock, [&] { return !queue_.empty() || stopping_; });
+	sleeping_.store(false, std::memory_order_relaxed);
+	if (stopping_ && queue_.empty())
+	  return;
+      }
+    }
+
+    const printer_type& printer_;
+    const OverflowPolicy overflow_;
+    const size_t sample_rate_;
+    detail::message_queue<printer_type> queue_;
+    std::atomic<size_t> dropped_{0};
+    std::atomic<size_t> overflows_{0}; // Messages that found the queue full, for sampling
+    std::atomic<size_t> processed_{0};
+    std::atomic<size_t> flush_waiters_{0};
+    std::atomic<bool> sleeping_{false}; // The formatter thread waits for messages
+    bool stopping_ = false;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    std::thread thread_; // Started last, once the members it uses are ready
+  };
+
+  typedef BasicAsyncPrinter<RuntimePolicy> AsyncPrinter;
+
+  namespace detail {
+
+    // Binary log records hold the arguments of one print or print_inline
+    // call as a descriptor of their types and a payload of their values.
+    // A descriptor is a string of type codes in prefix order, which is
+    // registered once per argument list and referred to by its hash, so
+    // that records only carry the payload:
+    //
+    //   P n args    print with n arguments  I n args    print_inline
+    //   n           nullptr (no payload)    b           bool (1 byte)
+    //   c           char (1 byte)           i w / u w   integer of w bytes
+    //   f d e       float, double, long double (raw bytes)
+    //   s           string: length, bytes   z           C string: 0 if null, else 1 and a string
+    //   x           value without a binary form, formatted when logged: length, bytes
+    //   [ T         list: count, items      { T         set or initializer_list
+    //   q T         queue: count, items     k T         stack: count, items from the top
+    //   m K V       map: count, entries     ~           prefix of a forward-only { or m
+    //   ( n Ts      tuple or pair           ? T         optional: 0 or 1 and the value
+    //   | n Ts      variant: index, value
+    //
+    // Counts, lengths and n are unsigned LEB128 varints; integers and
+    // floating-point values are in the byte order of the machine
+    namespace binary_code {
+      inline constexpr char print = 'P';
+      inline constexpr char print_inline = 'I';
+      inline constexpr char null = 'n';
+      inline constexpr char boolean = 'b';
+      inline constexpr char character = 'c';
+      inline constexpr char integer = 'i';
+      inline constexpr char unsigned_integer = 'u';
+      inline constexpr char float32 = 'f';
+      inline constexpr char float64 = 'd';
+      inline constexpr char extended = 'e';
+      inline constexpr char string = 's';
+      inline constexpr char c_string = 'z';
+      inline constexpr char text = 'x';
+      inline constexpr char list = '[';
+      inline constexpr char set = '{';
+      inline constexpr char queue = 'q';
+      inline constexpr char stack = 'k';
+      inline constexpr char map = 'm';
+      inline constexpr char forward_only = '~';
+      inline constexpr char tuple = '(';
+      inline constexpr char optional = '?';
+      inline constexpr char variant = '|';
+    }
+
+    inline void write_varint(std::string& out, std::uint64_t value) {
+      while (value >= 0x80) {
+	out += static_cast<char>(value | 0x80);
+	value >>= 7;
+      }
+      out += static_cast<char>(value);
+    }
+
+    template <typename T>
+    void write_raw(std::string& out, const T& value) {
+      out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    inline void write_bytes(std::string& out, std::string_view value) {
+      write_varint(out, value.size());
+      out.append(value.data(), value.size());
+    }
+
+    // Arithmetic types whose values are logged as raw bytes
+    template <typename T>
+    struct is_binary_arithmetic : std::bool_constant<(is_integer<T>::value && sizeof(T) <= sizeof(std::uint64_t)) ||
+						     std::is_floating_point<T>::value> {};
+
+    template <typename Range>
+    struct is_forward_only : std::bool_constant<!std::is_base_of<
+      std::bidirectional_iterator_tag,
+      typename std::iterator_traits<typename Range::const_iterator>::iterator_category>::value> {};
+
+    template <typename T>
+    void binary_describe(std::string& out);
+
+    template <typename Tuple, size_t... Is>
+    void binary_describe_elements(std::string& out, std::index_sequence<Is...>) {
+      (binary_describe<std::decay_t<std::tuple_element_t<Is, Tuple>>>(out), ...);
+    }
+
+    template <typename... Ts>
+    void binary_describe_alternatives(std::string& out, const std::variant<Ts...> *) {
+      write_varint(out, sizeof...(Ts));
+      (binary_describe<Ts>(out), ...);
+    }
+
+    // Character arrays, such as string literals, print as C strings
+    template <typename T>
+    struct is_char_array : std::bool_constant<std::is_array<T>::value &&
+					       std::is_same<std::remove_cv_t<std::remove_extent_t<T>>, char>::value> {};
+
+    // Appends the descriptor of T, following the categories the printer uses
+    template <typename T>
+    void binary_describe(std::string& out) {
+      constexpr category kind = category_v<T>;
+      if constexpr (kind == category::formatted)
+	out += binary_code::text;
+      else if constexpr (is_char_array<T>::value)
+	out += binary_code::c_string;
+      else if constexpr (std::is_same<T, bool>::value)
+	out += binary_code::boolean;
+      else if constexpr (std::is_same<T, char>::value)
+	out += binary_code::character;
+      else if constexpr (is_binary_arithmetic<T>::value && is_integer<T>::value) {
+	out += std::is_signed<T>::value ? binary_code::integer : binary_code::unsigned_integer;
+	out += static_cast<char>(sizeof(T));
+      }
+      else if constexpr (std::is_same<T, float>::value)
+	out += binary_code::float32;
+      else if constexpr (std::is_same<T, double>::value)
+	out += binary_code::float64;
+      else if constexpr (std::is_same<T, long double>::value)
+	out += binary_code::extended;
+      else if constexpr (std::is_null_pointer<T>::value)
+	out += binary_code::null;
+      else if constexpr (std::is_same<T, const char *>::value)
+	out += binary_code::c_string;
+      else if constexpr (kind == category::string)
+	out += binary_code::string;
+      else if constexpr (is_specialization<T, std::initializer_list>::value) {
+	out += binary_code::set;
+	binary_describe<typename T::value_type>(out);
+      }
+      else if constexpr (kind == category::range) {
+	if constexpr (range_traits<T>::brackets == square_brackets) {
+	  out += binary_code::list;
+	}
+	else {
+	  if constexpr (is_forward_only<T>::value)
+	    out += binary_code::forward_only;
+	  out += binary_code::set;
+	}
+	binary_describe<typename T::value_type>(out);
+      }
+      else if constexpr (kind == category::map) {
+	if constexpr (is_forward_only<T>::value)
+	  out += binary_code::forward_only;
+	out += binary_code::map;
+	binary_describe<typename T::key_type>(out);
+	binary_describe<typename T::mapped_type>(out);
+      }
+      else if constexpr (kind == category::tuple) {
+	out += binary_code::tuple;
+	write_varint(out, std::tuple_size<T>::value);
+	binary_describe_elements<T>(out, std::make_index_sequence<std::tuple_size<T>::value>());
+      }
+      else if constexpr (kind == category::adaptor) {
+	out += is_specialization<T, std::stack>::value ? binary_code::stack : binary_code::queue;
+	binary_describe<typename T::value_type>(out);
+      }
+      else if constexpr (is_specialization<T, std::optional>::value) {
+	out += binary_code::optional;
+	binary_describe<typename T::value_type>(out);
+      }
+      else if constexpr (kind == category::wrapper) {
+	out += binary_code::variant;
+	binary_describe_alternatives(out, static_cast<const T *>(nullptr));
+      }
+      else
+	out += binary_code::text;
+    }
+
+    // Appends the payload of `value` for the descriptor of T. `format`
+    // appends the text of values without a binary form
+    template <typename T, typename Format>
+    void binary_encode(std::string& out, const T& value, const Format& format) {
+      constexpr category kind = category_v<T>;
+      if constexpr (kind == category::formatted)
+	format(out, value);
+      else if constexpr (is_char_array<T>::value)
+	binary_encode(out, static_cast<const char *>(value), format);
+      else if constexpr (std::is_same<T, bool>::value || std::is_same<T, char>::value)
+	out += static_cast<char>(value);
+      else if constexpr (is_binary_arithmetic<T>::value)
+	write_raw(out, value);
+      else if constexpr (std::is_null_pointer<T>::value)
+	return;
+      else if constexpr (std::is_same<T, const char *>::value) {
+	out += static_cast<char>(value != nullptr);
+	if (value != nullptr)
+	  write_bytes(out, value);
+      }
+      else if constexpr (kind == category::string)
+	write_bytes(out, value);
+      else if constexpr (kind == category::range || kind == category::map) {
+	write_varint(out, value.size());
+	if constexpr (kind == category::range && !is_specialization<T, std::initializer_list>::value) {
+	  // Contiguous numbers are copied in one go
+	  if constexpr (range_traits<T>::contiguous && is_binary_arithmetic<typename T::value_type>::value) {
+	    out.append(reinterpret_cast<const char *>(value.data()), value.size() * sizeof(typename T::value_type));
+	    return;
+	  }
+	}
+	// Converted to the value type, which proxies like those of
+	// std::vector<bool> print as
+	for (const typename T::value_type& element : value) {
+	  if constexpr (kind == category::map) {
+	    binary_encode(out, element.first, format);
+	    binary_encode(out, element.second, format);
+	  }
+	  else {
+	    binary_encode(out, element, format);
+	  }
+	}
+      }
+      else if constexpr (kind == category::tuple) {
+	std::apply([&](const auto&... elements) { (binary_encode(out, elements, format), ...); }, value);
+      }
+      else if constexpr (kind == category::adaptor) {
+	typedef typename T::value_type Element;
+	const auto& container = adaptor_access<T>::container(value);
+	write_varint(out, container.size());
+	if constexpr (is_specialization<T, std::stack>::value) {
+	  for (auto element = container.rbegin(); element != container.rend(); ++element)
+	    binary_encode(out, *element, format);
+	}
+	else if constexpr (is_specialization<T, std::priority_queue>::value) {
+	  // In pop order, like the printer
+	  const auto& compare = adaptor_access<T>::compare(value);
+	  std::vector<const Element *> order;
+	  order.reserve(container.size());
+	  for (const Element& element : container)
+	    order.push_back(&element);
+	  std::sort(order.begin(), order.end(), [&compare](const Element * lhs, const Element * rhs) {
+	    return compare(*rhs, *lhs);
+	  });
+	  for (const Element * element : order)
+	    binary_encode(out, *element, format);
+	}
+	else {
+	  for (const Element& element : container)
+	    binary_encode(out, element, format);
+	}
+      }
+      else if constexpr (is_specialization<T, std::optional>::value) {
+	out += static_cast<char>(value.has_value());
+	if (value)
+	  binary_encode(out, *value, format);
+      }
+      else if constexpr (kind == category::wrapper) {
+	write_varint(out, value.index());
+	std::visit([&](const auto& alternative) { binary_encode(out, alternative, format); }, value);
+      }
+      else
+	format(out, value);
+    }
+
+    // Descriptors of the argument lists logged in this process. Each
+    // distinct descriptor gets the next number as its id, so two argument
+    // lists share an id only if they are logged the same way
+    class binary_descriptor_registry {
+    public:
+      static binary_descriptor_registry& instance() {
+	static binary_descriptor_registry registry;
+	return registry;
+      }
+
+      std::uint64_t add(const std::string& descriptor) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	const auto entry = ids_.emplace(descriptor, descriptors_.size());
+	if (entry.second)
+	  descriptors_.push_back(&entry.first->first);
+	return entry.first->second;
+      }
+
+      // Stays valid, since descriptors are never removed
+      const std::string& find(std::uint64_t id) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return *descriptors_.at(id);
+      }
+
+    private:
+      binary_descriptor_registry() = default;
+
+      mutable std::mutex mutex_;
+      std::unordered_map<std::string, std::uint64_t> ids_;
+      std::vector<const std::string *> descriptors_; // By id, pointing into ids_
+    };
+
+    // Registers the descriptor of an argument list on first use
+    template <bool Inline, typename... Ts>
+    std::uint64_t binary_record_type() {
+      static const std::uint64_t id = [] {
+	std::string descriptor(1, Inline ? binary_code::print_inline : binary_code::print);
+	write_varint(descriptor, sizeof...(Ts));
+	(binary_describe<Ts>(descriptor), ...);
+	return binary_descriptor_registry::instance().add(descriptor);
+      }();
+      return id;
+    }
+
+    // Bounds-checked reads from a descriptor or payload. A failed read
+    // sets the reader's failed flag and returns zeros
+    class binary_reader {
+    public:
+      explicit binary_reader(std::string_view data) :
+	position_(data.data()),
+	end_(data.data() + data.size()) {}
+
+      bool failed() const {
+	return failed_;
+      }
+
+      bool at_end() const {
+	return position_ == end_;
+      }
+
+      size_t remaining() const {
+	return static_cast<size_t>(end_ - position_);
+      }
+
+      char read_char() {
+	if (position_ == end_) {
+	  failed_ = true;
+	  return '\0';
+	}
+	return *position_++;
+      }
+
+      std::uint64_t read_varint() {
+	std::uint64_t value = 0;
+	for (unsigned shift = 0; shift < 64; shift += 7) {
+	  const unsigned char byte = static_cast<unsigned char>(read_char());
+	  value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+	  if ((byte & 0x80) == 0)
+	    return value;
+	}
+	failed_ = true;
+	return 0;
+      }
+
+      template <typename T>
+      T read_raw() {
+	T value{};
+	if (remaining() < sizeof(T)) {
+	  failed_ = true;
+	  position_ = end_;
+	  return value;
+	}
+	std::memcpy(&value, position_, sizeof(T));
+	position_ += sizeof(T);
+	return value;
+      }
+
+      std::string_view read_bytes() {
+	const std::uint64_t size = read_varint();
+	if (size > remaining()) {
+	  failed_ = true;
+	  position_ = end_;
+	  return {};
+	}
+	std::string_view value(position_, static_cast<size_t>(size));
+	position_ += size;
+	return value;
+      }
+
+    private:
+      const char * position_;
+      const char * end_;
+      bool failed_ = false;
+    };
+
+    // A parsed descriptor
+    struct binary_type {
+      char code = binary_code::null;
+      std::uint64_t width = 0; // Bytes of an integer
+      bool forward_only = false;
+      size_t min_size = 0; // Fewest payload bytes of a value, to reject impossible counts
+      std::vector<binary_type> children;
+    };
+
+    // A parsed descriptor, with the values that the last record of it was
+    // decoded into. The next record overwrites them in place, so records
+    // of one shape reuse the storage of strings and containers
+    struct binary_descriptor {
+      binary_type type;
+      DynamicValue::items_type arguments;
+    };
+
+    // Renders binary log records through a printer. Descriptors are parsed
+    // once and kept by the key the log refers to them with
+    class binary_decoder {
+    public:
+      static constexpr size_t max_depth = 256;
+
+      bool contains(std::uint64_t key) const {
+	return types_.count(key) > 0;
+      }
+
+      // Returns false if the descriptor is malformed
+      bool define(std::uint64_t key, std::string_view descriptor) {
+	binary_reader reader(descriptor);
+	binary_type type;
+	type.code = reader.read_char();
+	if (type.code != binary_code::print && type.code != binary_code::print_inline)
+	  return false;
+	const std::uint64_t count = reader.read_varint();
+	for (std::uint64_t i = 0; i < count && !reader.failed(); i++) {
+	  type.children.emplace_back();
+	  if (!parse(reader, type.children.back(), 0))
+	    return false;
+	}
+	if (reader.failed() || !reader.at_end())
+	  return false;
+	types_[key] = binary_descriptor{std::move(type), {}};
+	return true;
+      }
+
+      void clear() {
+	types_.clear();
+      }
+
+      // Returns false if the key is unknown or the payload doesn't match
+      // its descriptor. `printer` is a printer or the context of one
+      template <typename Printer>
+      bool print(std::uint64_t key, std::string_view payload, Printer& printer) {
+	const auto descriptor = types_.find(key);
+	if (descriptor == types_.end())
+	  return false;
+	const binary_type& type = descriptor->second.type;
+	DynamicValue::items_type& arguments = descriptor->second.arguments;
+	binary_reader reader(payload);
+	arguments.resize(type.children.size());
+	for (size_t i = 0; i < arguments.size(); i++) {
+	  if (!decode(reader, type.children[i], arguments[i]))
+	    return false;
+	}
+	if (!reader.at_end())
+	  return false;
+	printer.print_arguments(arguments, type.code == binary_code::print_inline);
+	return true;
+      }
+
+    private:
+      static bool parse(binary_reader& reader, binary_type& type, size_t depth) {
+	if (depth > max_depth)
+	  return false;
+	type.code = reader.read_char();
+	if (type.code == binary_code::forward_only) {
+	  type.forward_only = true;
+	  type.code = reader.read_char();
+	  if (type.code != binary_code::set && type.code != binary_code::map)
+	    return false;
+	}
+	size_t children = 0;
+	switch (type.code) {
+	case binary_code::null:
+	  break;
+	case binary_code::boolean:
+	case binary_code::character:
+	  type.min_size = 1;
+	  break;
+	case binary_code::integer:
+	case binary_code::unsigned_integer:
+	  type.width = static_cast<unsigned char>(reader.read_char());
+	  if (type.width != 1 && type.width != 2 && type.width != 4 && type.width != 8)
+	    return false;
+	  type.min_size = type.width;
+	  break;
+	case binary_code::float32:
+	  type.min_size = sizeof(float);
+	  break;
+	case binary_code::float64:
+	  type.min_size = sizeof(double);
+	  break;
+	case binary_code::extended:
+	  type.min_size = sizeof(long double);
+	  break;
+	case binary_code::string:
+	case binary_code::c_string:
+	case binary_code::text:
+	  type.min_size = 1;
+	  break;
+	case binary_code::list:
+	case binary_code::set:
+	case binary_code::queue:
+	case binary_code::stack:
+	  type.min_size = 1;
+	  children = 1;
+	  break;
+	case binary_code::map:
+	  type.min_size = 1;
+	  children = 2;
+	  break;
+	case binary_code::optional:
+	  type.min_size = 1;
+	  children = 1;
+	  break;
+	case binary_code::tuple:
+	case binary_code::variant:
+	  children = static_cast<size_t>((std::min)(reader.read_varint(), std::uint64_t{reader.remaining()}));
+	  if (type.code == binary_code::variant)
+	    type.min_size = 1;
+	  break;
+	default:
+	  return false;
+	}
+	type.children.resize(children);
+	for (binary_type& child : type.children) {
+	  if (!parse(reader, child, depth + 1))
+	    return false;
+	  if (type.code == binary_code::tuple)
+	    type.min_size += child.min_size;
+	}
+	return !reader.failed();
+      }
+
+      // Decodes into `out` in place, keeping the storage of the value that
+      // `out` held before where it has the same kind
+      static bool decode(binary_reader& reader, const binary_type& type, DynamicValue& out) {
+	typedef DynamicValue::Kind Kind;
+	switch (type.code) {
+	case binary_code::null:
+	  out.reset<std::monostate>(Kind::null);
+	  break;
+	case binary_code::boolean:
+	  out.reset<bool>(Kind::boolean) = reader.read_char() != 0;
+	  break;
+	case binary_code::character:
+	  out.reset<char>(Kind::character) = reader.read_char();
+	  break;
+	case binary_code::integer:
+	  out.reset<std::int64_t>(Kind::integer, static_cast<size_t>(type.width)) =
+	    read_integer<std::int8_t, std::int16_t, std::int32_t, std::int64_t>(reader, type.width);
+	  break;
+	case binary_code::unsigned_integer:
+	  out.reset<std::uint64_t>(Kind::unsigned_integer, static_cast<size_t>(type.width)) =
+	    read_integer<std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t>(reader, type.width);
+	  break;
+	case binary_code::float32:
+	  out.reset<float>(Kind::float32) = reader.read_raw<float>();
+	  break;
+	case binary_code::float64:
+	  out.reset<double>(Kind::float64) = reader.read_raw<double>();
+	  break;
+	case binary_code::extended:
+	  out.reset<long double>(Kind::extended) = reader.read_raw<long double>();
+	  break;
+	case binary_code::string:
+	  out.reset<std::string>(Kind::string) = reader.read_bytes();
+	  break;
+	case binary_code::text:
+	  out.reset<std::string>(Kind::text) = reader.read_bytes();
+	  break;
+	case binary_code::c_string:
+	  if (reader.read_char() != 0)
+	    out.reset<std::string>(Kind::string) = reader.read_bytes();
+	  else
+	    out.reset<std::monostate>(Kind::null);
+	  break;
+	case binary_code::list:
+	case binary_code::set:
+	case binary_code::queue:
+	case binary_code::stack: {
+	  const binary_type& element = type.children.front();
+	  const std::uint64_t count = reader.read_varint();
+	  if (!fits(reader, count, element.min_size))
+	    return false;
+	  const Kind kind = type.code == binary_code::list ? Kind::list : type.code == binary_code::set ? Kind::set :
+	    type.code == binary_code::queue ? Kind::queue : Kind::stack;
+	  DynamicValue::items_type& items = out.reset<DynamicValue::items_type>(kind, 0, type.forward_only);
+	  items.resize(static_cast<size_t>(count));
+	  for (DynamicValue& item : items) {
+	    if (!decode(reader, element, item))
+	      return false;
+	  }
+	  break;
+	}
+	case binary_code::map: {
+	  const std::uint64_t count = reader.read_varint();
+	  if (!fits(reader, count, type.children[0].min_size + type.children[1].min_size))
+	    return false;
+	  DynamicValue::entries_type& entries = out.reset<DynamicValue::entries_type>(Kind::map, 0, type.forward_only);
+	  entries.resize(static_cast<size_t>(count));
+	  for (auto& entry : entries) {
+	    if (!decode(reader, type.children[0], entry.first) || !decode(reader, type.children[1], entry.second))
+	      return false;
+	  }
+	  break;
+	}
+	case binary_code::tuple: {
+	  DynamicValue::items_type& items = out.reset<DynamicValue::items_type>(Kind::tuple);
+	  items.resize(type.children.size());
+	  for (size_t i = 0; i < items.size(); i++) {
+	    if (!decode(reader, type.children[i], items[i]))
+	      return false;
+	  }
+	  break;
+	}
+	case binary_code::optional: {
+	  DynamicValue::items_type& items = out.reset<DynamicValue::items_type>(Kind::wrapper);
+	  if (reader.read_char() != 0) {
+	    items.resize(1);
+	    if (!decode(reader, type.children.front(), items.front()))
+	      return false;
+	  }
+	  else {
+	    items.clear();
+	  }
+	  break;
+	}
+	case binary_code::variant: {
+	  const std::uint64_t index = reader.read_varint();
+	  if (index >= type.children.size())
+	    return false;
+	  DynamicValue::items_type& items = out.reset<DynamicValue::items_type>(Kind::wrapper);
+	  items.resize(1);
+	  if (!decode(reader, type.children[static_cast<size_t>(index)], items.front()))
+	    return false;
+	  break;
+	}
+	default:
+	  return false;
+	}
+	return !reader.failed();
+      }
+
+      // Whether `count` values of at least `min_size` bytes each can follow
+      static bool fits(const binary_reader& reader, std::uint64_t count, size_t min_size) {
+	return !reader.failed() && (min_size == 0 ? count <= reader.remaining() + max_empty_values :
+				    count <= reader.remaining() / min_size);
+      }
+
+      template <typename T8, typename T16, typename T32, typename T64>
+      static T64 read_integer(binary_reader& reader, std::uint64_t width) {
+	switch (width) {
+	case 1: return reader.read_raw<T8>();
+	case 2: return reader.read_raw<T16>();
+	case 4: return reader.read_raw<T32>();
+	default: return reader.read_raw<T64>();
+	}
+      }
+
+      // Values without payload bytes (nullptr, empty tuples) that a
+      // sequence may hold beyond the size of the rest of the record
+      static constexpr std::uint64_t max_empty_values = 1 << 24;
+
+      std::unordered_map<std::uint64_t, binary_descriptor> types_;
+    };
+
+    // Records buffered by one thread. Only the drain side takes the
+    // mutex of another thread's buffer
+    struct binary_buffer {
+      std::mutex mutex;
+      std::string records;
+      std::string taken; // Records moved out by the last drain
+      bool exited = false; // The thread has ended, so the logger can drop the buffer once it is drained
+    };
+
+    // The buffers of the calling thread, one per logger it has logged to.
+    // The loggers own them; when the thread ends, the buffers of the
+    // loggers that still exist are marked as exited
+    class binary_thread_buffers {
+    public:
+      ~binary_thread_buffers() {
+	for (const auto& entry : buffers_) {
+	  if (const std::shared_ptr<binary_buffer> buffer = entry.second.lock()) {
+	    std::lock_guard<std::mutex> lock(buffer->mutex);
+	    buffer->exited = true;
+	  }
+	}
+      }
+
+      static binary_thread_buffers& local() {
+	thread_local binary_thread_buffers buffers;
+	return buffers;
+      }
+
+      // The buffer of the logger with `id`, or null
+      binary_buffer * find(std::uint64_t id) const {
+	for (const auto& entry : buffers_) {
+	  if (entry.first == id)
+	    return entry.second.lock().get();
+	}
+	return nullptr;
+      }
+
+      void add(std::uint64_t id, const std::shared_ptr<binary_buffer>& buffer) {
+	// Forget the buffers of loggers that have been destroyed
+	buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(), [](const auto& entry) {
+	  return entry.second.expired();
+	}), buffers_.end());
+	buffers_.emplace_back(id, buffer);
+      }
+
+    private:
+      std::vector<std::pair<std::uint64_t, std::weak_ptr<binary_buffer>>> buffers_;
+    };
+
+    // Header of a buffered record, followed by its payload
+    struct binary_record_header {
+      std::uint64_t sequence; // Position of the call among all calls to the logger
+      std::uint64_t type;     // Id of the descriptor
+      std::uint64_t size;     // Bytes of payload
+    };
+
+    // A buffered record located by a drain
+    struct binary_record {
+      std::uint64_t sequence;
+      std::uint64_t type;
+      std::string_view payload;
+    };
+
+    inline std::atomic<std::uint64_t> binary_logger_count{0};
+
+    // Start of each segment of a binary log: the magic bytes, the format
+    // version, then the byte order (1 for little endian) and
+    // sizeof(long double) of the machine that wrote it
+    inline constexpr std::string_view binary_log_magic = "PPBL";
+    inline constexpr char binary_log_version = 1;
+    inline constexpr char binary_log_descriptor = 'D'; // Number, descriptor
+    inline constexpr char binary_log_record = 'R';     // Descriptor number, payload
+    inline constexpr char binary_log_end = 'E';
+
+    inline bool is_little_endian() {
+      const std::uint16_t probe = 1;
+      unsigned char first;
+      std::memcpy(&first, &probe, 1);
+      return first == 1;
+    }
+
+    inline std::string binary_log_header() {
+      std::string header(binary_log_magic);
+      header += binary_log_version;
+      header += static_cast<char>(is_little_endian());
+      header += static_cast<char>(sizeof(long double));
+      return header;
+    }
+
+    // Reads an unsigned LEB128 varint from a stream
+    inline bool read_varint(std::istream& in, std::uint64_t& value) {
+      value = 0;
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+	const int byte = in.get();
+	if (byte == std::char_traits<char>::eof())
+	  return false;
+	value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+	if ((byte & 0x80) == 0)
+	  return true;
+      }
+      return false;
+    }
+
+    inline bool read_bytes(std::istream& in, std::string& value) {
+      std::uint64_t size;
+      if (!read_varint(in, size))
+	return false;
+      // Grow with the data read rather than trusting the size up front
+      value.clear();
+      char block[4096];
+      while (size > 0) {
+	const size_t chunk = static_cast<size_t>((std::min)(size, std::uint64_t{sizeof(block)}));
+	if (!in.read(block, static_cast<std::streamsize>(chunk)))
+	  return false;
+	value.append(block, chunk);
+	size -= chunk;
+      }
+      return true;
+    }
+
+  }
+
+  // Logs the arguments of print calls as compact binary records and
+  // formats them later, in the manner of NanoLog: print copies the bytes
+  // of numbers, strings and container lengths into a buffer of the calling
+  // thread and returns. flush() renders the records buffered so far
+  // through the printer, in the order of the calls and exactly as print
+  // would have printed them; write() moves them into a binary log instead,
+  // which print_binary_log (or the pprint_decode tool) renders later.
+  //
+  // Values without a binary form (enums, pointers, std::complex and
+  // classes printed through a formatter or operator<<) are formatted when
+  // they are logged, with the printer's settings at that time. The
+  // printer must outlive this object; records that were neither flushed
+  // nor written when it is destroyed are discarded
+  template <typename Policy>
+  class BasicBinaryLogger {
+  public:
+    typedef BasicPrinter<Policy> printer_type;
+
+    explicit BasicBinaryLogger(const printer_type& printer) :
+      printer_(printer),
+      id_(++detail::binary_logger_count) {}
+
+    BasicBinaryLogger(const BasicBinaryLogger&) = delete;
+    BasicBinaryLogger& operator=(const BasicBinaryLogger&) = delete;
+
+    template <typename T, typename... Targs>
+    void print(const T& value, const Targs&... Fargs) {
+      log<false>(value, Fargs...);
+    }
+
+    template <typename T, typename... Targs>
+    void print_inline(const T& value, const Targs&... Fargs) {
+      log<true>(value, Fargs...);
+    }
+
+    // Prints the records logged before the call through the printer. Can
+    // be called from any thread, e.g., periodically from a thread of its own
+    void flush() {
+      std::lock_guard<std::mutex> lock(drain_mutex_);
+      collect();
+      const auto& registry = detail::binary_descriptor_registry::instance();
+      // One context for all records, each with the byte budget of a call
+      printer_.with_context([&](auto& context) {
+	for (const detail::binary_record& record : records_) {
+	  if (!decoder_.contains(record.type))
+	    decoder_.define(record.type, registry.find(record.type));
+	  decoder_.print(record.type, record.payload, context);
+	}
+      });
+    }
+
+    // Appends the records logged before the call to `log` as a segment of
+    // a binary log, with the descriptors they refer to
+    void write(std::ostream& log) {
+      std::lock_guard<std::mutex> lock(drain_mutex_);
+      collect();
+      const auto& registry = detail::binary_descriptor_registry::instance();
+      std::string segment = detail::binary_log_header();
+      std::unordered_map<std::uint64_t, std::uint64_t> numbers;
+      for (const detail::binary_record& record : records_) {
+	auto number = numbers.find(record.type);
+	if (number == numbers.end()) {
+	  number = numbers.emplace(record.type, numbers.size()).first;
+	  segment += detail::binary_log_descriptor;
+	  detail::write_varint(segment, number->second);
+	  detail::write_bytes(segment, registry.find(record.type));
+	}
+	segment += detail::binary_log_record;
+	detail::write_varint(segment, number->second);
+	detail::write_bytes(segment, record.payload);
+      }
+      segment += detail::binary_log_end;
+      log.write(segment.data(), static_cast<std::streamsize>(segment.size()));
+    }
+
+  private:
+    template <bool Inline, typename... Targs>
+    void log(const Targs&... Fargs) {
+      const std::uint64_t type = detail::binary_record_type<Inline, Targs...>();
+      auto format = [this](std::string& out, const auto& value) {
+	detail::write_bytes(out, printer_.format_nested(value));
+      };
+      detail::binary_buffer& buffer = local_buffer();
+      std::lock_guard<std::mutex> lock(buffer.mutex);
+      std::string& out = buffer.records;
+      const size_t start = out.size();
+      try {
+	out.resize(start + sizeof(detail::binary_record_header));
+	(detail::binary_encode(out, Fargs, format), ...);
+      }
+      catch (...) {
+	out.resize(start);
+	throw;
+      }
+      // Numbered under the buffer's lock, so that a drain, which holds all
+      // of them, sees every record numbered before it
+      const detail::binary_record_header header{sequence_.fetch_add(1, std::memory_order_relaxed), type,
+						out.size() - start - sizeof(detail::binary_record_header)};
+      std::memcpy(&out[start], &header, sizeof(header));
+    }
+
+    // The calling thread's buffer, looked up once and then remembered for
+    // as long as the thread keeps logging to this logger
+    detail::binary_buffer& local_buffer() {
+      thread_local std::uint64_t cached_logger = 0;
+      thread_local detail::binary_buffer * cached_buffer = nullptr;
+      if (cached_logger != id_) {
+	detail::binary_thread_buffers& thread_buffers = detail::binary_thread_buffers::local();
+	cached_buffer = thread_buffers.find(id_);
+	if (!cached_buffer) {
+	  const auto buffer = std::make_shared<detail::binary_buffer>();
+	  {
+	    std::lock_guard<std::mutex> lock(buffers_mutex_);
+	    buffers_.push_back(buffer);
+	  }
+	  thread_buffers.add(id_, buffer);
+	  cached_buffer = buffer.get();
+	}
+	cached_logger = id_;
+      }
+      return *cached_buffer;
+    }
+
+    // Moves the buffered records of all threads out, in call order
+    void collect() {
+      {
+	std::lock_guard<std::mutex> lock(buffers_mutex_);
+	for (auto& buffer : buffers_)
+	  buffer->mutex.lock();
+	for (auto& buffer : buffers_) {
+	  buffer->taken.clear();
+	  std::swap(buffer->records, buffer->taken);
+	}
+	// The buffer of a thread that has ended is dropped, with its
+	// storage, by the first drain that finds nothing left in it. The
+	// others keep their order, which is the order they are locked in
+	const auto drained = std::stable_partition(buffers_.begin(), buffers_.end(), [](const auto& buffer) {
+	  return !buffer->exited || !buffer->taken.empty();
+	});
+	for (auto& buffer : buffers_)
+	  buffer->mutex.unlock();
+	buffers_.erase(drained, buffers_.end());
+
+	records_.clear();
+	for (auto& buffer : buffers_) {
+	  const std::string& taken = buffer->taken;
+	  for (size_t position = 0; position < taken.size();) {
+	    detail::binary_record_header header;
+	    std::memcpy(&header, &taken[position], sizeof(header));
+	    position += sizeof(header);
+	    records_.push_back({header.sequence, header.type, std::string_view(&taken[position], header.size)});
+	    position += header.size;
+	  }
+	}
+      }
+      std::sort(records_.begin(), records_.end(), [](const detail::binary_record& lhs,
+						     const detail::binary_record& rhs) {
+	return lhs.sequence < rhs.sequence;
+      });
+    }
+
+    const printer_type& printer_;
+    const std::uint64_t id_; // Identifies the logger to the threads' buffer caches
+    std::atomic<std::uint64_t> sequence_{0};
+    std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<detail::binary_buffer>> buffers_; // Buffers of the threads that have logged
+    std::mutex drain_mutex_; // Serializes flush and write
+    std::vector<detail::binary_record> records_; // Records of the current drain, pointing into the taken buffers
+    detail::binary_decoder decoder_;
+  };
+
+  typedef BasicBinaryLogger<RuntimePolicy> BinaryLogger;
+
+  // Streams records to `log` in the binary log format as they are printed.
+  // The descriptor of an argument list is written once per segment, the
+  // first time those types are printed; after that, a record carries only
+  // the number of its descriptor and the encoded values: no brackets,
+  // separators or type names, and numbers in their raw bytes rather than
+  // formatted. print_binary_log, and the pprint_decode tool, print the
+  // records back as `printer` would have.
+  //
+  // Records are buffered and handed to `log` in blocks; close, which the
+  // destructor calls, ends the segment. A segment that isn't closed is
+  // read up to its last complete record. One RecordStream can be used from
+  // several threads at once
+  template <typename Policy>
+  class BasicRecordStream {
+  public:
+    typedef BasicPrinter<Policy> printer_type;
+
+    // Buffered bytes past which print hands the records to the stream
+    static constexpr size_t buffer_size = 64 * 1024;
+
+    BasicRecordStream(std::ostream& log, const printer_type& printer) :
+      log_(log),
+      printer_(printer) {}
+
+    BasicRecordStream(const BasicRecordStream&) = delete;
+    BasicRecordStream& operator=(const BasicRecordStream&) = delete;
+
+    ~BasicRecordStream() {
+      close();
+    }
+
+    template <typename T, typename... Targs>
+    void print(const T& value, const Targs&... Fargs) {
+      record<false>(value, Fargs...);
+    }
+
+    template <typename T, typename... Targs>
+    void print_inline(const T& value, const Targs&... Fargs) {
+      record<true>(value, Fargs...);
+    }
+
+    // Hands the buffered records to the stream, keeping the segment open
+    void flush() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      write_buffer();
+    }
+
+    // Ends the segment and hands it to the stream. Records printed after
+    // this start a new segment, which repeats the descriptors it uses
+    void close() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!open_)
+	return;
+      buffer_ += detail::binary_log_end;
+      write_buffer();
+      numbers_.clear();
+      open_ = false;
+    }
+
+  private:
+    template <bool Inline, typename... Targs>
+    void record(const Targs&... Fargs) {
+      const std::uint64_t type = detail::binary_record_type<Inline, Targs...>();
+      auto format = [this](std::string& out, const auto& value) {
+	detail::write_bytes(out, printer_.format_nested(value));
+      };
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Encoded first, so that a value that throws leaves no trace
+      payload_.clear();
+      (detail::binary_encode(payload_, Fargs, format), ...);
+
+      if (!open_) {
+	buffer_ += detail::binary_log_header();
+	open_ = true;
+      }
+      auto number = numbers_.find(type);
+      if (number == numbers_.end()) {
+	number = numbers_.emplace(type, numbers_.size()).first;
+	buffer_ += detail::binary_log_descriptor;
+	detail::write_varint(buffer_, number->second);
+	detail::write_bytes(buffer_, detail::binary_descriptor_registry::instance().find(type));
+      }
+      buffer_ += detail::binary_log_record;
+      detail::write_varint(buffer_, number->second);
+      detail::write_bytes(buffer_, payload_);
+      if (buffer_.size() >= buffer_size)
+	write_buffer();
+    }
+
+    void write_buffer() {
+      log_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+      buffer_.clear();
+    }
+
+    std::ostream& log_;
+    const printer_type& printer_; // Formats the values that have no binary form
+    std::mutex mutex_;
+    bool open_ = false; // Whether a segment has been started
+    std::unordered_map<std::uint64_t, std::uint64_t> numbers_; // Descriptor numbers in the segment, by type
+    std::string buffer_;
+    std::string payload_;
+  };
+
+  typedef BasicRecordStream<RuntimePolicy> RecordStream;
+
+  // Prints the records of a binary log written by BasicBinaryLogger::write
+  // through `printer`, segment by segment. Returns false if the log is
+  // malformed or was written on a machine with a different byte order or
+  // long double; the records before the fault have been printed by then
+  template <typename Policy>
+  bool print_binary_log(std::istream& log, const BasicPrinter<Policy>& printer) {
+    const std::string header = detail::binary_log_header();
+    std::string bytes;
+    detail::binary_decoder decoder;
+    while (log.peek() != std::char_traits<char>::eof()) {
+      bytes.resize(header.size());
+      if (!log.read(&bytes[0], static_cast<std::streamsize>(bytes.size())) || bytes != header)
+	return false;
+      decoder.clear();
+      for (;;) {
+	const int tag = log.get();
+	std::uint64_t number;
+	if (tag == detail::binary_log_end)
+	  break;
+	if ((tag != detail::binary_log_descriptor && tag != detail::binary_log_record) ||
+	    !detail::read_varint(log, number) || !detail::read_bytes(log, bytes))
+	  return false;
+	if (tag == detail::binary_log_descriptor ? !decoder.define(number, bytes) :
+	    !decoder.print(number, bytes, printer))
+	  return false;
+      }
+    }
+    return true;
+  }
+
+
+  namespace detail {
+
+    // Flags the bytes of an 8-byte block that a JSON string can't hold as
+    // is (SWAR): control characters, quotes and backslashes, which are
+    // escaped, and non-ASCII bytes, which are checked for valid UTF-8.
+    // Zero if there are none. Bytes after the first flagged one may be
+    // flagged falsely, by the borrow of the subtractions
+    inline std::uint64_t json_special_bytes(std::uint64_t block) {
+      constexpr std::uint64_t ones = 0x0101010101010101ull;
+      constexpr std::uint64_t highs = 0x8080808080808080ull;
+      const std::uint64_t quote = block ^ (ones * '"');
+      const std::uint64_t backslash = block ^ (ones * '\\');
+      return ((block - ones * 0x20) & ~block & highs) |
+	((quote - ones) & ~quote & highs) |
+	((backslash - ones) & ~backslash & highs) |
+	(block & highs);
+    }
+
+    inline bool is_json_plain(unsigned char c) {
+      return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+    }
+
+    // Length of the well-formed UTF-8 sequence at the start of
+    // [first, last), or 0 if there is none: overlong forms, surrogates and
+    // code points past U+10FFFF are rejected
+    inline size_t utf8_sequence_length(const unsigned char * first, const unsigned char * last) {
+      const unsigned char lead = *first;
+      size_t length;
+      std::uint32_t code;
+      std::uint32_t min;
+      if (lead < 0xC2)
+	return 0;
+      else if (lead < 0xE0) {
+	length = 2;
+	code = lead & 0x1Fu;
+	min = 0x80;
+      }
+      else if (lead < 0xF0) {
+	length = 3;
+	code = lead & 0x0Fu;
+	min = 0x800;
+      }
+      else if (lead < 0xF5) {
+	length = 4;
+	code = lead & 0x07u;
+	min = 0x10000;
+      }
+      else
+	return 0;
+      if (static_cast<size_t>(last - first) < length)
+	return 0;
+      for (size_t i = 1; i < length; i++) {
+	if ((first[i] & 0xC0) != 0x80)
+	  return 0;
+	code = (code << 6) | (first[i] & 0x3Fu);
+      }
+      if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+	return 0;
+      return length;
+    }
+
+    // Characters of the longest escaped form of `size` bytes
+    inline constexpr size_t max_json_escaped_chars(size_t size) {
+      return 6 * size;
+    }
+
+    // Writes the characters of `value` as they appear in a JSON string to
+    // `out`, which must have room for max_json_escaped_chars(value.size())
+    // characters, and returns one past the last character written. Runs of
+    // plain ASCII are copied 8 bytes at a time; bytes that are not valid
+    // UTF-8 become U+FFFD
+    inline char * escape_json(char * out, std::string_view value) {
+      static constexpr char hex_digits[] = "0123456789abcdef";
+      const unsigned char * first = reinterpret_cast<const unsigned char *>(value.data());
+      const unsigned char * const last = first + value.size();
+      for (;;) {
+	while (last - first >= 8) {
+	  std::uint64_t block;
+	  std::memcpy(&block, first, 8);
+	  if (json_special_bytes(block) != 0)
+	    break;
+	  std::memcpy(out, first, 8);
+	  out += 8;
+	  first += 8;
+	}
+	while (first != last && is_json_plain(*first))
+	  *out++ = static_cast<char>(*first++);
+	if (first == last)
+	  break;
+	const unsigned char c = *first;
+	if (c >= 0x80) {
+	  const size_t length = utf8_sequence_length(first, last);
+	  if (length == 0) {
+	    std::memcpy(out, "\\ufffd", 6);
+	    out += 6;
+	    first += 1;
+	  }
+	  else {
+	    std::memcpy(out, first, length);
+	    out += length;
+	    first += length;
+	  }
+	  continue;
+	}
+	*out++ = '\\';
+	switch (c) {
+	case '"': *out++ = '"'; break;
+	case '\\': *out++ = '\\'; break;
+	case '\b': *out++ = 'b'; break;
+	case '\f': *out++ = 'f'; break;
+	case '\n': *out++ = 'n'; break;
+	case '\r': *out++ = 'r'; break;
+	case '\t': *out++ = 't'; break;
+	default:
+	  std::memcpy(out, "u00", 3);
+	  out[3] = hex_digits[c >> 4];
+	  out[4] = hex_digits[c & 0xF];
+	  out += 5;
+	}
+	first += 1;
+      }
+      return out;
+    }
+
+    // Types whose values can be the names of a JSON object: they are
+    // strings, or numbers and enums written as strings
+    template <typename T>
+    struct is_json_key : std::bool_constant<category_v<T> == category::string || is_char_array<T>::value ||
+					    (category_v<T> == category::scalar &&
+					     !is_specialization<T, std::complex>::value)> {};
+
+    // Writes the JSON text of one JsonPrinter::print call into an output
+    // buffer of its own. Values that JSON has no form for are written as
+    // strings of their pprint text, formatted by `text`
+    class json_writer {
+    public:
+      json_writer(std::ostream& stream, std::recursive_mutex& sink_mutex, const PrettyPrinter& text) :
+	buffer_(stream, sink_mutex),
+	text_(text) {}
+
+      void write(char value) {
+	buffer_.write(value);
+      }
+
+      void flush() {
+	buffer_.flush();
+      }
+
+      template <typename T>
+      void value(const T& value) {
+	constexpr category kind = category_v<T>;
+	if constexpr (kind == category::formatted)
+	  string(text_.format_nested(value));
+	else if constexpr (std::is_same<T, bool>::value)
+	  buffer_.write(value ? std::string_view("true") : std::string_view("false"));
+	else if constexpr (std::is_same<T, char>::value)
+	  string(std::string_view(&value, 1));
+	else if constexpr (is_integer<T>::value) {
+	  char * first = buffer_.reserve(max_integer_chars);
+	  buffer_.commit(format_integer(first, value));
+	}
+	else if constexpr (std::is_floating_point<T>::value)
+	  number(value);
+	else if constexpr (std::is_null_pointer<T>::value)
+	  null();
+	else if constexpr (std::is_enum<T>::value) {
+	  const auto name = magic_enum::enum_name(value);
+	  if (name.has_value())
+	    string(name.value());
+	  else
+	    this->value(static_cast<std::underlying_type_t<T>>(value));
+	}
+	else if constexpr (is_char_array<T>::value)
+	  this->value(static_cast<const char *>(value));
+	else if constexpr (std::is_same<T, const char *>::value) {
+	  if (value == nullptr)
+	    null();
+	  else
+	    string(value);
+	}
+	else if constexpr (kind == category::string)
+	  string(value);
+	else if constexpr (kind == category::range)
+	  array(value);
+	else if constexpr (kind == category::map) {
+	  if constexpr (is_json_key<typename T::key_type>::value &&
+			!is_specialization<T, std::multimap>::value &&
+			!is_specialization<T, std::unordered_multimap>::value)
+	    object(value);
+	  else
+	    pairs(value);
+	}
+	else if constexpr (kind == category::tuple) {
+	  write('[');
+	  size_t index = 0;
+	  std::apply([&](const auto&... elements) {
+	    ((index++ > 0 ? write(',') : void(), this->value(elements)), ...);
+	  }, value);
+	  write(']');
+	}
+	else if constexpr (kind == category::adaptor)
+	  adaptor(value);
+	else if constexpr (is_specialization<T, std::optional>::value) {
+	  if (value)
+	    this->value(*value);
+	  else
+	    null();
+	}
+	else if constexpr (kind == category::wrapper)
+	  std::visit([this](const auto& alternative) { this->value(alternative); }, value);
+	else if constexpr (is_specialization<T, std::complex>::value) {
+	  write('[');
+	  this->value(value.real());
+	  write(',');
+	  this->value(value.imag());
+	  write(']');
+	}
+	else if constexpr (std::is_pointer<T>::value) {
+	  if (value == nullptr)
+	    null();
+	  else
+	    string(text_.format_nested(value));
+	}
+	else
+	  string(text_.format_nested(value));
+      }
+
+    private:
+      void null() {
+	buffer_.write(std::string_view("null"));
+      }
+
+      // Not-a-number and the infinities have no JSON form
+      template <typename T>
+      void number(T value) {
+	if (!std::isfinite(value))
+	  return null();
+	constexpr size_t capacity = max_floating_chars<T>(FloatFormat::shortest, 0);
+	char * first = buffer_.reserve(capacity);
+	buffer_.commit(format_floating(first, first + capacity, value, FloatFormat::shortest, 0));
+      }
+
+      void string(std::string_view value) {
+	// Escaped in slices, so that the room reserved for the worst case
+	// stays small
+	constexpr size_t slice = 4096;
+	write('"');
+	for (size_t position = 0; position < value.size();) {
+	  size_t length = (std::min)(slice, value.size() - position);
+	  // Don't split a UTF-8 sequence, which has at most three
+	  // continuation bytes
+	  for (int i = 0; i < 3 && position + length < value.size() &&
+		 (static_cast<unsigned char>(value[position + length]) & 0xC0) == 0x80; i++)
+	    length -= 1;
+	  char * first = buffer_.reserve(max_json_escaped_chars(length));
+	  buffer_.commit(escape_json(first, value.substr(position, length)));
+	  position += length;
+	}
+	write('"');
+      }
+
+      // Elements of a range, or of a container adaptor in printing order
+      template <typename Range>
+      void array(const Range& range) {
+	write('[');
+	bool first = true;
+	// Converted to the value type, which proxies like those of
+	// std::vector<bool> are written as
+	for (const typename Range::value_type& element : range) {
+	  if (!first)
+	    write(',');
+	  first = false;
+	  value(element);
+	}
+	write(']');
+      }
+
+      template <typename Map>
+      void object(const Map& map) {
+	write('{');
+	bool first = true;
+	for (const auto& entry : map) {
+	  if (!first)
+	    write(',');
+	  first = false;
+	  key(entry.first);
+	  write(':');
+	  value(entry.second);
+	}
+	write('}');
+      }
+
+      // Maps whose keys can't be object names, as an array of [key, value]
+      template <typename Map>
+      void pairs(const Map& map) {
+	write('[');
+	bool first = true;
+	for (const auto& entry : map) {
+	  if (!first)
+	    write(',');
+	  first = false;
+	  write('[');
+	  value(entry.first);
+	  write(',');
+	  value(entry.second);
+	  write(']');
+	}
+	write(']');
+      }
+
+      // Writes an object name: strings and named enums as they are, other
+      // values as a string of their JSON text
+      template <typename Key>
+      void key(const Key& key) {
+	if constexpr (category_v<Key> == category::string || std::is_same<Key, char>::value) {
+	  if constexpr (std::is_same<Key, const char *>::value) {
+	    if (key == nullptr)
+	      return string("null");
+	  }
+	  value(key);
+	}
+	else if constexpr (std::is_enum<Key>::value) {
+	  const auto name = magic_enum::enum_name(key);
+	  if (name.has_value())
+	    return string(name.value());
+	  write('"');
+	  value(static_cast<std::underlying_type_t<Key>>(key));
+	  write('"');
+	}
+	else {
+	  write('"');
+	  value(key);
+	  write('"');
+	}
+      }
+
+      template <typename Adaptor>
+      void adaptor(const Adaptor& value) {
+	typedef typename Adaptor::value_type Element;
+	const auto& container = adaptor_access<Adaptor>::container(value);
+	if constexpr (is_specialization<Adaptor, std::stack>::value) {
+	  // Top of the stack first
+	  write('[');
+	  for (auto element = container.rbegin(); element != container.rend(); ++element) {
+	    if (element != container.rbegin())
+	      write(',');
+	    this->value(*element);
+	  }
+	  write(']');
+	}
+	else if constexpr (is_specialization<Adaptor, std::priority_queue>::value) {
+	  // In pop order
+	  const auto& compare = adaptor_access<Adaptor>::compare(value);
+	  std::vector<const Element *> order;
+	  order.reserve(container.size());
+	  for (const Element& element : container)
+	    order.push_back(&element);
+	  std::sort(order.begin(), order.end(), [&compare](const Element * lhs, const Element * rhs) {
+	    return compare(*rhs, *lhs);
+	  });
+	  write('[');
+	  for (size_t i = 0; i < order.size(); i++) {
+	    if (i > 0)
+	      write(',');
+	    this->value(*order[i]);
+	  }
+	  write(']');
+	}
+	else {
+	  array(container);
+	}
+      }
+
+      output_buffer buffer_;
+      const PrettyPrinter& text_;
+    };
+
+  }
+
+  // Prints values as JSON text (RFC 8259), one compact document per print
+  // call and line, through the same type dispatch as PrettyPrinter:
+  // sequences, sets, tuples and container adaptors become arrays; maps
+  // with string, number or enum keys objects, and other maps arrays of
+  // [key, value] pairs; std::optional null or its value; std::variant its
+  // active alternative. Strings are escaped and bytes that are not valid
+  // UTF-8 replaced by U+FFFD; NaN and the infinities become null. Values
+  // that JSON has no form for (pointers, std::complex aside, and classes
+  // printed through a formatter or operator<<) become strings of their
+  // pprint text. Like the other printers, one JsonPrinter can be used from
+  // several threads at once
+  class JsonPrinter {
+  public:
+    JsonPrinter(std::ostream& stream = std::cout) :
+      stream_(stream),
+      text_(stream) {}
+
+    template <typename T>
+    void print(const T& value) const {
+      detail::json_writer writer(stream_, sink_mutex_, text_);
+      writer.value(value);
+      writer.write('\n');
+      writer.flush();
+    }
+
+  private:
+    std::ostream& stream_;
+    PrettyPrinter text_; // Formats the values that are written as pprint text
+    mutable std::recursive_mutex sink_mutex_;
+  };
+
+
+  namespace detail {
+
+    // Whether `value` is well-formed UTF-8. ASCII is skipped 8 bytes at a time
+    inline bool is_valid_utf8(std::string_view value) {
+      const unsigned char * first = reinterpret_cast<const unsigned char *>(value.data());
+      const unsigned char * const last = first + value.size();
+      while (first != last) {
+	while (last - first >= 8) {
+	  std::uint64_t block;
+	  std::memcpy(&block, first, 8);
+	  if ((block & 0x8080808080808080ull) != 0)
+	    break;
+	  first += 8;
+	}
+	if (first == last)
+	  break;
+	if (*first < 0x80) {
+	  first += 1;
+	  continue;
+	}
+	const size_t length = utf8_sequence_length(first, last);
+	if (length == 0)
+	  return false;
+	first += length;
+      }
+      return true;
+    }
+
+    // CBOR (RFC 8949) major types, tags and simple values
+    namespace cbor {
+      inline constexpr unsigned unsigned_integer = 0;
+      inline constexpr unsigned negative_integer = 1;
+      inline constexpr unsigned byte_string = 2;
+      inline constexpr unsigned text_string = 3;
+      inline constexpr unsigned array = 4;
+      inline constexpr unsigned map = 5;
+      inline constexpr unsigned tag = 6;
+      inline constexpr unsigned simple = 7;
+
+      inline constexpr std::uint64_t positive_bignum_tag = 2;
+      inline constexpr std::uint64_t negative_bignum_tag = 3;
+      inline constexpr std::uint64_t set_tag = 258;
+      // Typed arrays (RFC 8746) are tagged 64 to 87: 0b010fsell, with f
+      // for floating point, s for signed, e for little endian and ll for
+      // the size of the elements (1, 2, 4 or 8 bytes for integers; 2, 4, 8
+      // or 16 for floating point)
+      inline constexpr std::uint64_t first_typed_array_tag = 64;
+      inline constexpr std::uint64_t last_typed_array_tag = 87;
+
+      inline constexpr unsigned char false_value = 0xF4;
+      inline constexpr unsigned char true_value = 0xF5;
+      inline constexpr unsigned char null_value = 0xF6;
+      inline constexpr unsigned char undefined_value = 0xF7;
+      inline constexpr unsigned char half_float = 0xF9;
+      inline constexpr unsigned char single_float = 0xFA;
+      inline constexpr unsigned char double_float = 0xFB;
+      inline constexpr unsigned char break_code = 0xFF;
+      inline constexpr unsigned indefinite = 31;
+
+      // Longest head: the initial byte and an 8-byte argument
+      inline constexpr size_t max_head_size = 9;
+    }
+
+    // Writes the `size` low bytes of `value` in big-endian order
+    inline char * write_big_endian(char * out, std::uint64_t value, size_t size) {
+      for (size_t i = size; i > 0; i--)
+	*out++ = static_cast<char>(value >> (8 * (i - 1)));
+      return out;
+    }
+
+    // Writes the head of a data item: its major type and the shortest
+    // encoding of its argument
+    inline char * cbor_head(char * out, unsigned major, std::uint64_t argument) {
+      const unsigned char type = static_cast<unsigned char>(major << 5);
+      if (argument < 24) {
+	*out++ = static_cast<char>(type | argument);
+	return out;
+      }
+      size_t size = argument <= 0xFF ? 1 : argument <= 0xFFFF ? 2 : argument <= 0xFFFFFFFF ? 4 : 8;
+      *out++ = static_cast<char>(type | (size == 1 ? 24 : size == 2 ? 25 : size == 4 ? 26 : 27));
+      return write_big_endian(out, argument, size);
+    }
+
+    // Tag of the typed array for elements of type T in the byte order of
+    // this machine, or 0 if there is none
+    template <typename T>
+    std::uint64_t cbor_typed_array_tag() {
+      constexpr size_t size = sizeof(T);
+      const std::uint64_t little_endian = is_little_endian() ? 4 : 0;
+      if constexpr (std::is_floating_point<T>::value) {
+	if constexpr (size == 4 || size == 8)
+	  return 80 + little_endian + (size == 4 ? 1 : 2);
+	else
+	  return 0;
+      }
+      else if constexpr (is_integer<T>::value && size <= 8) {
+	// Single bytes have no byte order
+	const std::uint64_t length = size == 1 ? 0 : size == 2 ? 1 : size == 4 ? 2 : 3;
+	return 64 + (std::is_signed<T>::value ? 8 : 0) + (size == 1 ? 0 : little_endian) + length;
+      }
+      else
+	return 0;
+    }
+
+    // Writes the CBOR encoding of one CborPrinter::print call into an
+    // output buffer of its own
+    class cbor_writer {
+    public:
+      cbor_writer(std::ostream& stream, std::recursive_mutex& sink_mutex, const PrettyPrinter& text) :
+	buffer_(stream, sink_mutex),
+	text_(text) {}
+
+      template <typename T>
+      void value(const T& value) {
+	constexpr category kind = category_v<T>;
+	if constexpr (kind == category::formatted)
+	  string(text_.format_nested(value));
+	else if constexpr (std::is_same<T, bool>::value)
+	  buffer_.write(static_cast<char>(value ? cbor::true_value : cbor::false_value));
+	else if constexpr (std::is_same<T, char>::value)
+	  string(std::string_view(&value, 1));
+	else if constexpr (is_integer<T>::value)
+	  integer(value);
+	else if constexpr (std::is_same<T, float>::value) {
+	  std::uint32_t bits;
+	  std::memcpy(&bits, &value, sizeof(bits));
+	  char * out = buffer_.reserve(5);
+	  *out++ = static_cast<char>(cbor::single_float);
+	  buffer_.commit(write_big_endian(out, bits, 4));
+	}
+	else if constexpr (std::is_floating_point<T>::value) {
+	  // long double is narrowed to double, which CBOR has
+	  const double narrowed = static_cast<double>(value);
+	  std::uint64_t bits;
+	  std::memcpy(&bits, &narrowed, sizeof(bits));
+	  char * out = buffer_.reserve(9);
+	  *out++ = static_cast<char>(cbor::double_float);
+	  buffer_.commit(write_big_endian(out, bits, 8));
+	}
+	else if constexpr (std::is_null_pointer<T>::value)
+	  buffer_.write(static_cast<char>(cbor::null_value));
+	else if constexpr (std::is_enum<T>::value) {
+	  const auto name = magic_enum::enum_name(value);
+	  if (name.has_value())
+	    string(name.value());
+	  else
+	    integer(static_cast<std::underlying_type_t<T>>(value));
+	}
+	else if constexpr (is_char_array<T>::value)
+	  this->value(static_cast<const char *>(value));
+	else if constexpr (std::is_same<T, const char *>::value) {
+	  if (value == nullptr)
+	    buffer_.write(static_cast<char>(cbor::null_value));
+	  else
+	    string(value);
+	}
+	else if constexpr (kind == category::string)
+	  string(value);
+	else if constexpr (kind == category::range) {
+	  if constexpr (is_specialization<T, std::initializer_list>::value)
+	    array(value, value.size());
+	  else if constexpr (range_traits<T>::brackets == curly_brackets) {
+	    head(cbor::tag, cbor::set_tag);
+	    array(value, value.size());
+	  }
+	  else if constexpr (range_traits<T>::contiguous && is_batch_arithmetic<typename T::value_type>::value) {
+	    if (!typed_array(value.data(), value.size()))
+	      array(value, value.size());
+	  }
+	  else
+	    array(value, value.size());
+	}
+	else if constexpr (kind == category::map) {
+	  if constexpr (is_specialization<T, std::multimap>::value ||
+			is_specialization<T, std::unordered_multimap>::value) {
+	    // Map keys must be unique, so repeated keys go in [key, value] pairs
+	    head(cbor::array, value.size());
+	    for (const auto& entry : value) {
+	      head(cbor::array, 2);
+	      this->value(entry.first);
+	      this->value(entry.second);
+	    }
+	  }
+	  else {
+	    head(cbor::map, value.size());
+	    for (const auto& entry : value) {
+	      this->value(entry.first);
+	      this->value(entry.second);
+	    }
+	  }
+	}
+	else if constexpr (kind == category::tuple) {
+	  head(cbor::array, std::tuple_size<T>::value);
+	  std::apply([this](const auto&... elements) { (this->value(elements), ...); }, value);
+	}
+	else if constexpr (kind == category::adaptor)
+	  adaptor(value);
+	else if constexpr (is_specialization<T, std::optional>::value) {
+	  // An empty optional is undefined, which tells it apart from nullptr
+	  if (value)
+	    this->value(*value);
+	  else
+	    buffer_.write(static_cast<char>(cbor::undefined_value));
+	}
+	else if constexpr (kind == category::wrapper)
+	  std::visit([this](const auto& alternative) { this->value(alternative); }, value);
+	else if constexpr (is_specialization<T, std::complex>::value) {
+	  head(cbor::array, 2);
+	  this->value(value.real());
+	  this->value(value.imag());
+	}
+	else if constexpr (std::is_pointer<T>::value) {
+	  if (value == nullptr)
+	    buffer_.write(static_cast<char>(cbor::null_value));
+	  else
+	    string(text_.format_nested(value));
+	}
+	else
+	  string(text_.format_nested(value));
+      }
+
+      void flush() {
+	buffer_.flush();
+      }
+
+    private:
+      void head(unsigned major, std::uint64_t argument) {
+	char * out = buffer_.reserve(cbor::max_head_size);
+	buffer_.commit(cbor_head(out, major, argument));
+      }
+
+      template <typename T>
+      void integer(T value) {
+	if constexpr (static_cast<T>(-1) < static_cast<T>(0)) {
+	  if (value < 0) {
+	    // -1 - n, computed without overflow
+	    return magnitude(cbor::negative_integer, cbor::negative_bignum_tag,
+			     static_cast<typename unsigned_integer<T>::type>(-(value + 1)));
+	  }
+	}
+	magnitude(cbor::unsigned_integer, cbor::positive_bignum_tag,
+		  static_cast<typename unsigned_integer<T>::type>(value));
+      }
+
+      // Integers past 64 bits go in a bignum of their big-endian bytes
+      template <typename U>
+      void magnitude(unsigned major, std::uint64_t bignum_tag, U value) {
+	if constexpr (sizeof(U) > sizeof(std::uint64_t)) {
+	  if (value > (std::numeric_limits<std::uint64_t>::max)()) {
+	    head(cbor::tag, bignum_tag);
+	    char bytes[sizeof(U)];
+	    size_t size = 0;
+	    for (; value != 0; value >>= 8)
+	      bytes[sizeof(U) - ++size] = static_cast<char>(value & 0xFF);
+	    head(cbor::byte_string, size);
+	    buffer_.write(bytes + sizeof(U) - size, size);
+	    return;
+	  }
+	}
+	head(major, static_cast<std::uint64_t>(value));
+      }
+
+      void string(std::string_view value) {
+	// Text must be UTF-8; other bytes go in a byte string
+	head(is_valid_utf8(value) ? cbor::text_string : cbor::byte_string, value.size());
+	buffer_.write(value);
+      }
+
+      template <typename Range>
+      void array(const Range& range, size_t size) {
+	head(cbor::array, size);
+	// Converted to the value type, which proxies like those of
+	// std::vector<bool> are written as
+	for (const typename Range::value_type& element : range)
+	  value(element);
+      }
+
+      // Contiguous numbers as a typed array: the tag, then their bytes in
+      // one copy. Returns false if there is no typed array for T
+      template <typename T>
+      bool typed_array(const T * data, size_t size) {
+	const std::uint64_t tag = cbor_typed_array_tag<T>();
+	if (tag == 0)
+	  return false;
+	head(cbor::tag, tag);
+	head(cbor::byte_string, size * sizeof(T));
+	buffer_.write(reinterpret_cast<const char *>(data), size * sizeof(T));
+	return true;
+      }
+
+      template <typename Adaptor>
+      void adaptor(const Adaptor& value) {
+	typedef typename Adaptor::value_type Element;
+	const auto& container = adaptor_access<Adaptor>::container(value);
+	head(cbor::array, container.size());
+	if constexpr (is_specialization<Adaptor, std::stack>::value) {
+	  // Top of the stack first
+	  for (auto element = container.rbegin(); element != container.rend(); ++element)
+	    this->value(*element);
+	}
+	else if constexpr (is_specialization<Adaptor, std::priority_queue>::value) {
+	  // In pop order
+	  const auto& compare = adaptor_access<Adaptor>::compare(value);
+	  std::vector<const Element *> order;
+	  order.reserve(container.size());
+	  for (const Element& element : container)
+	    order.push_back(&element);
+	  std::sort(order.begin(), order.end(), [&compare](const Element * lhs, const Element * rhs) {
+	    return compare(*rhs, *lhs);
+	  });
+	  for (const Element * element : order)
+	    this->value(*element);
+	}
+	else {
+	  for (const Element& element : container)
+	    this->value(element);
+	}
+      }
+
+      output_buffer buffer_;
+      const PrettyPrinter& text_;
+    };
+
+    // Reads CBOR data items into dynamic values
+    class cbor_reader {
+    public:
+      static constexpr size_t max_depth = 256;
+
+      cbor_reader(std::string_view data, size_t position) :
+	data_(data),
+	position_(position) {}
+
+      size_t position() const {
+	return position_;
+      }
+
+      bool read(DynamicValue& out, size_t depth = 0) {
+	typedef DynamicValue::Kind Kind;
+	if (depth > max_depth || position_ >= data_.size())
+	  return false;
+	const unsigned char initial = static_cast<unsigned char>(data_[position_++]);
+	const unsigned major = initial >> 5;
+	const unsigned info = initial & 0x1F;
+	if (major == cbor::simple)
+	  return simple(initial, out);
+	std::uint64_t argument = 0;
+	const bool indefinite = info == cbor::indefinite;
+	if (indefinite) {
+	  if (major == cbor::unsigned_integer || major == cbor::negative_integer || major == cbor::tag)
+	    return false;
+	}
+	else if (!read_argument(info, argument))
+	  return false;
+
+	switch (major) {
+	case cbor::unsigned_integer:
+	  out = DynamicValue::unsigned_integer(argument);
+	  return true;
+	case cbor::negative_integer:
+	  if (argument <= static_cast<std::uint64_t>((std::numeric_limits<std::int64_t>::max)()))
+	    out = DynamicValue::integer(-1 - static_cast<std::int64_t>(argument));
+	  else
+	    out = DynamicValue::text(negative_text(argument));
+	  return true;
+	case cbor::byte_string:
+	case cbor::text_string: {
+	  std::string bytes;
+	  if (!read_string(major, indefinite, argument, bytes))
+	    return false;
+	  out = DynamicValue::string(std::move(bytes));
+	  return true;
+	}
+	case cbor::array: {
+	  DynamicValue::items_type items;
+	  if (!read_items(indefinite, argument, items, depth))
+	    return false;
+	  out = DynamicValue::sequence(Kind::list, std::move(items));
+	  return true;
+	}
+	case cbor::map: {
+	  DynamicValue::entries_type entries;
+	  if (!indefinite && argument > remaining() / 2)
+	    return false;
+	  for (std::uint64_t i = 0; indefinite || i < argument; i++) {
+	    if (indefinite && at_break())
+	      break;
+	    entries.emplace_back();
+	    if (!read(entries.back().first, depth + 1) || !read(entries.back().second, depth + 1))
+	      return false;
+	  }
+	  out = DynamicValue::map(std::move(entries));
+	  return true;
+	}
+	default:
+	  return tagged(argument, out, depth);
+	}
+      }
+
+    private:
+      size_t remaining() const {
+	return data_.size() - position_;
+      }
+
+      bool at_break() {
+	if (position_ < data_.size() && static_cast<unsigned char>(data_[position_]) == cbor::break_code) {
+	  position_ += 1;
+	  return true;
+	}
+	return false;
+      }
+
+      bool read_big_endian(size_t size, std::uint64_t& value) {
+	if (remaining() < size)
+	  return false;
+	value = 0;
+	for (size_t i = 0; i < size; i++)
+	  value = (value << 8) | static_cast<unsigned char>(data_[position_++]);
+	return true;
+      }
+
+      bool read_argument(unsigned info, std::uint64_t& argument) {
+	if (info < 24) {
+	  argument = info;
+	  return true;
+	}
+	if (info > 27)
+	  return false;
+	return read_big_endian(size_t{1} << (info - 24), argument);
+      }
+
+      static std::string negative_text(std::uint64_t argument) {
+	// -1 - argument, whose magnitude may not fit in 64 bits
+	if (argument == (std::numeric_limits<std::uint64_t>::max)())
+	  return "-18446744073709551616";
+	char digits[max_integer_chars + 1];
+	digits[0] = '-';
+	return std::string(digits, format_integer(digits + 1, argument + 1));
+      }
+
+      bool simple(unsigned char initial, DynamicValue& out) {
+	std::uint64_t bits;
+	switch (initial) {
+	case cbor::false_value:
+	  out = DynamicValue::boolean(false);
+	  return true;
+	case cbor::true_value:
+	  out = DynamicValue::boolean(true);
+	  return true;
+	case cbor::null_value:
+	  out = DynamicValue();
+	  return true;
+	case cbor::undefined_value:
+	  out = DynamicValue::wrapper();
+	  return true;
+	case cbor::half_float:
+	  if (!read_big_endian(2, bits))
+	    return false;
+	  out = DynamicValue::floating(half_to_float(static_cast<std::uint16_t>(bits)));
+	  return true;
+	case cbor::single_float: {
+	  if (!read_big_endian(4, bits))
+	    return false;
+	  const std::uint32_t single = static_cast<std::uint32_t>(bits);
+	  float value;
+	  std::memcpy(&value, &single, sizeof(value));
+	  out = DynamicValue::floating(value);
+	  return true;
+	}
+	case cbor::double_float: {
+	  if (!read_big_endian(8, bits))
+	    return false;
+	  double value;
+	  std::memcpy(&value, &bits, sizeof(value));
+	  out = DynamicValue::floating(value);
+	  return true;
+	}
+	default: {
+	  // Other simple values, by number
+	  const unsigned info = initial & 0x1F;
+	  if (info == 24) {
+	    if (!read_big_endian(1, bits) || bits < 32)
+	      return false;
+	  }
+	  else if (info < 20)
+	    bits = info;
+	  else
+	    return false;
+	  out = DynamicValue::text("simple(" + std::to_string(bits) + ")");
+	  return true;
+	}
+	}
+      }
+
+      static float half_to_float(std::uint16_t half) {
+	const int exponent = (half >> 10) & 0x1F;
+	const int mantissa = half & 0x3FF;
+	float value;
+	if (exponent == 0)
+	  value = std::ldexp(static_cast<float>(mantissa), -24);
+	else if (exponent != 31)
+	  value = std::ldexp(static_cast<float>(mantissa + 1024), exponent - 25);
+	else
+	  value = mantissa == 0 ? std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN();
+	return (half & 0x8000) ? -value : value;
+      }
+
+      bool read_string(unsigned major, bool indefinite, std::uint64_t size, std::string& out) {
+	if (!indefinite) {
+	  if (size > remaining())
+	    return false;
+	  out.append(data_.data() + position_, static_cast<size_t>(size));
+	  position_ += static_cast<size_t>(size);
+	  return true;
+	}
+	// Chunks of the same major type, up to a break
+	while (!at_break()) {
+	  if (position_ >= data_.size())
+	    return false;
+	  const unsigned char initial = static_cast<unsigned char>(data_[position_++]);
+	  std::uint64_t chunk;
+	  if ((initial >> 5) != major || (initial & 0x1F) == cbor::indefinite ||
+	      !read_argument(initial & 0x1F, chunk) || !read_string(major, false, chunk, out))
+	    return false;
+	}
+	return true;
+      }
+
+      bool read_items(bool indefinite, std::uint64_t count, DynamicValue::items_type& items, size_t depth) {
+	// Every item takes at least a byte
+	if (!indefinite && count > remaining())
+	  return false;
+	items.reserve(static_cast<size_t>(count));
+	for (std::uint64_t i = 0; indefinite || i < count; i++) {
+	  if (indefinite && at_break())
+	    break;
+	  items.emplace_back();
+	  if (!read(items.back(), depth + 1))
+	    return false;
+	}
+	return true;
+      }
+
+      bool tagged(std::uint64_t tag, DynamicValue& out, size_t depth) {
+	typedef DynamicValue::Kind Kind;
+	if (tag >= cbor::first_typed_array_tag && tag <= cbor::last_typed_array_tag)
+	  return typed_array(tag, out);
+	if (tag == cbor::positive_bignum_tag || tag == cbor::negative_bignum_tag)
+	  return bignum(tag == cbor::negative_bignum_tag, out);
+	DynamicValue content;
+	if (!read(content, depth + 1))
+	  return false;
+	if (tag == cbor::set_tag && content.kind() == Kind::list)
+	  out = DynamicValue::sequence(Kind::set, content.items());
+	else
+	  out = std::move(content); // Other tags print as their content
+	return true;
+      }
+
+      bool bytes_content(std::string& bytes) {
+	if (position_ >= data_.size())
+	  return false;
+	const unsigned char initial = static_cast<unsigned char>(data_[position_++]);
+	std::uint64_t size = 0;
+	if ((initial >> 5) != cbor::byte_string)
+	  return false;
+	const bool indefinite = (initial & 0x1F) == cbor::indefinite;
+	if (!indefinite && !read_argument(initial & 0x1F, size))
+	  return false;
+	return read_string(cbor::byte_string, indefinite, size, bytes);
+      }
+
+      bool bignum(bool negative, DynamicValue& out) {
+	std::string bytes;
+	if (!bytes_content(bytes))
+	  return false;
+	size_t first = 0;
+	while (first < bytes.size() && bytes[first] == '\0')
+	  first += 1;
+	const size_t size = bytes.size() - first;
+	std::uint64_t value = 0;
+	if (size <= 8) {
+	  for (size_t i = first; i < bytes.size(); i++)
+	    value = (value << 8) | static_cast<unsigned char>(bytes[i]);
+	  if (!negative)
+	    out = DynamicValue::unsigned_integer(value);
+	  else if (value <= static_cast<std::uint64_t>((std::numeric_limits<std::int64_t>::max)()))
+	    out = DynamicValue::integer(-1 - static_cast<std::int64_t>(value));
+	  else
+	    out = DynamicValue::text(negative_text(value));
+	  return true;
+	}
+#ifdef __SIZEOF_INT128__
+	if (size <= 16) {
+	  uint128 wide = 0;
+	  for (size_t i = first; i < bytes.size(); i++)
+	    wide = (wide << 8) | static_cast<unsigned char>(bytes[i]);
+	  char digits[max_integer_chars + 2];
+	  char * out_first = digits;
+	  if (negative) {
+	    *out_first++ = '-';
+	    if (wide == ~uint128(0)) {
+	      out = DynamicValue::text("-340282366920938463463374607431768211456");
+	      return true;
+	    }
+	    wide += 1;
+	  }
+	  out = DynamicValue::text(std::string(digits, format_integer(out_first, wide)));
+	  return true;
+	}
+#endif
+	// Too wide to print in decimal
+	static constexpr char hex_digits[] = "0123456789abcdef";
+	std::string text = negative ? "-1 - 0x" : "0x";
+	for (size_t i = first; i < bytes.size(); i++) {
+	  text += hex_digits[static_cast<unsigned char>(bytes[i]) >> 4];
+	  text += hex_digits[static_cast<unsigned char>(bytes[i]) & 0xF];
+	}
+	out = DynamicValue::text(std::move(text));
+	return true;
+      }
+
+      template <typename T>
+      static T load(const char * bytes, bool swap) {
+	char copy[sizeof(T)];
+	for (size_t i = 0; i < sizeof(T); i++)
+	  copy[i] = bytes[swap ? sizeof(T) - 1 - i : i];
+	T value;
+	std::memcpy(&value, copy, sizeof(T));
+	return value;
+      }
+
+      bool typed_array(std::uint64_t tag, DynamicValue& out) {
+	typedef DynamicValue::Kind Kind;
+	std::string bytes;
+	if (!bytes_content(bytes))
+	  return false;
+	const bool floating = (tag & 0x10) != 0;
+	const bool is_signed = (tag & 0x08) != 0;
+	const bool little_endian = (tag & 0x04) != 0;
+	const unsigned length = static_cast<unsigned>(tag & 0x03);
+	const size_t size = floating ? size_t{2} << length : size_t{1} << length;
+	// 76 is reserved, and 128-bit floats have no type to go to
+	if (tag == 76 || (floating && (is_signed || size == 16)) || bytes.size() % size != 0)
+	  return false;
+	const bool swap = size > 1 && little_endian != is_little_endian();
+	DynamicValue::items_type items;
+	items.reserve(bytes.size() / size);
+	for (const char * element = bytes.data(); element != bytes.data() + bytes.size(); element += size) {
+	  if (floating) {
+	    if (size == 2)
+	      items.push_back(DynamicValue::floating(half_to_float(load<std::uint16_t>(element, swap))));
+	    else if (size == 4)
+	      items.push_back(DynamicValue::floating(load<float>(element, swap)));
+	    else
+	      items.push_back(DynamicValue::floating(load<double>(element, swap)));
+	  }
+	  else if (is_signed) {
+	    const std::int64_t value = size == 1 ? load<std::int8_t>(element, swap) :
+	      size == 2 ? load<std::int16_t>(element, swap) :
+	      size == 4 ? load<std::int32_t>(element, swap) : load<std::int64_t>(element, swap);
+	    items.push_back(DynamicValue::integer(value, size));
+	  }
+	  else {
+	    const std::uint64_t value = size == 1 ? load<std::uint8_t>(element, swap) :
+	      size == 2 ? load<std::uint16_t>(element, swap) :
+	      size == 4 ? load<std::uint32_t>(element, swap) : load<std::uint64_t>(element, swap);
+	    items.push_back(DynamicValue::unsigned_integer(value, size));
+	  }
+	}
+	out = DynamicValue::sequence(Kind::list, std::move(items));
+	return true;
+      }
+
+      std::string_view data_;
+      size_t position_;
+    };
+
+  }
+
+  // Writes values in CBOR (RFC 8949), one data item per print call, so
+  // that the output is a CBOR sequence (RFC 8742). It uses the same type
+  // dispatch as PrettyPrinter:
+  // - Sequences, tuples and container adaptors become arrays.
+  // - Sets become arrays tagged as sets (258).
+  // - Maps become maps, and multimaps arrays of [key, value] pairs.
+  // - An empty std::optional becomes undefined, nullptr null, and
+  //   std::variant its active alternative.
+  // - Contiguous integers and floating-point values (e.g., std::vector<int>)
+  //   become typed arrays (RFC 8746), copied in one go in the byte order
+  //   of this machine.
+  // Strings become text strings, or byte strings if they are not valid
+  // UTF-8, and long double is narrowed to double. Values that CBOR has no
+  // form for (pointers, and classes printed through a formatter or
+  // operator<<) become text strings of their pprint text. decode_cbor and
+  // print_cbor read the items back
+  class CborPrinter {
+  public:
+    CborPrinter(std::ostream& stream = std::cout) :
+      stream_(stream),
+      text_(stream) {}
+
+    template <typename T>
+    void print(const T& value) const {
+      detail::cbor_writer writer(stream_, sink_mutex_, text_);
+      writer.value(value);
+      writer.flush();
+    }
+
+  private:
+    std::ostream& stream_;
+    PrettyPrinter text_; // Formats the values that are written as pprint text
+    mutable std::recursive_mutex sink_mutex_;
+  };
+
+  // Reads the CBOR data item that starts at `position` in `data` and
+  // advances `position` past it. Arrays, maps and typed arrays become
+  // lists and maps, arrays tagged as sets become sets, undefined becomes an
+  // empty optional; other tags are dropped in favor of their content.
+  // Returns false, leaving `position` as it was, if the item is malformed
+  // or truncated
+  inline bool decode_cbor(std::string_view data, size_t& position, DynamicValue& value) {
+    detail::cbor_reader reader(data, position);
+    if (!reader.read(value))
+      return false;
+    position = reader.position();
+    return true;
+  }
+
+  // Prints each data item of the CBOR sequence in `in` through `printer`.
+  // Returns false if an item is malformed; the items before it have been
+  // printed by then
+  template <typename Policy>
+  bool print_cbor(std::istream& in, const BasicPrinter<Policy>& printer) {
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    const std::string data = contents.str();
+    DynamicValue value;
+    for (size_t position = 0; position < data.size();) {
+      if (!decode_cbor(data, position, value))
+	return false;
+      printer.print(value);
+    }
+    return true;
+  }
+
 }
@@ -5,3 +5,30 @@
 #include <test_vector.hpp>
 #include <test_list.hpp>
 #include <test_set.hpp>
+#include <test_map.hpp>
+#include <test_adaptor.hpp>
+#include <test_initializer_list.hpp>
+#include <test_tuple.hpp>
+// Truncation
+#include <test_truncation.hpp>
+// Argument passing
+#include <test_forwarding.hpp>
+// Output buffering
+#include <test_buffer.hpp>
+// Fundamental types
+#include <test_integer.hpp>
+#include <test_floating.hpp>
+// Type names
+#include <test_type_name.hpp>
+// User-defined types
+#include <test_formatter.hpp>
+// Printer policies
+#include <test_policy.hpp>
+// Concurrency
+#include <test_thread.hpp>
+#include <test_async.hpp>
+// Deferred formatting
+#include <test_binary.hpp>
+// Output backends
+#include <test_json.hpp>
+#include <test_cbor.hpp>
@@ -0,0 +1,60 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+TEST_CASE("Print queue (line_terminator = '\n', indent = 2)",
+	  "[std::queue]") {
+  std::queue<int> foo;
+  for (int n : {1, 8, 5, 6})
+    foo.push(n);
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(foo);
+
+  const std::string expected = "[1, 8, 5, 6]\n";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(foo.size() == 4);
+}
+
+TEST_CASE("Print stack (line_terminator = '\n', indent = 2)",
+	  "[std::stack]") {
+  std::stack<int> foo;
+  for (int n : {1, 2, 3})
+    foo.push(n);
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.print(foo);
+
+  const std::string expected = "[\n"
+    "  3, \n"
+    "  2, \n"
+    "  1"
+    "\n]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print priority queue (line_terminator = '\n', indent = 2)",
+	  "[std::priority_queue]") {
+  std::priority_queue<int> foo;
+  std::priority_queue<int, std::vector<int>, std::greater<int>> bar;
+  for (int n : {1, 8, 5, 6, 3, 4, 0, 9, 7, 2}) {
+    foo.push(n);
+    bar.push(n);
+  }
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(foo);
+  printer.print(bar);
+
+  const std::string expected = "[9, 8, 7, 6, 5, 4, 3, 2, 1, 0]\n"
+    "[0, 1, 2, 3, 4, 5, 6, 7, 8, 9]\n";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(foo.top() == 9);
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+#include <future>
+#include <thread>
+
+// Holds up the formatter thread of an AsyncPrinter until it is opened
+struct Gate {
+  std::shared_ptr<std::promise<void>> entered;
+  std::shared_future<void> open;
+};
+
+namespace pprint {
+
+  template <>
+  struct formatter<Gate> {
+    template <typename Context>
+    void format(const Gate& gate, Context& context) const {
+      gate.entered->set_value();
+      gate.open.wait();
+      context.write("gate");
+    }
+  };
+
+}
+
+TEST_CASE("Async print in order (line_terminator = '\n', indent = 2)",
+	  "[async]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  pprint::AsyncPrinter async(printer, 16);
+  std::string expected;
+  for (int i = 0; i < 100; i++) {
+    async.print("line", i, std::vector<int>{i, i});
+    expected += "line " + std::to_string(i) + " [" + std::to_string(i) + ", " + std::to_string(i) + "]\n";
+  }
+  async.flush();
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Async print captures copies of its arguments (line_terminator = '\n', indent = 2)",
+	  "[async]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.quotes(true).compact(true);
+  {
+    pprint::AsyncPrinter async(printer);
+    char buffer[] = "before";
+    std::string text = "kept";
+    std::vector<int> moved {1, 2, 3};
+    const char * null = nullptr;
+    async.print(buffer, std::string_view(text), null);
+    async.print_inline(std::move(moved));
+    buffer[0] = 'X';
+    text = "changed";
+  }
+
+  const std::string expected = "\"before\" \"kept\" nullptr\n  [1, 2, 3]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Async print from several threads (line_terminator = '\n', indent = 2)",
+	  "[async]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  pprint::AsyncPrinter async(printer, 8);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&async, t] {
+      for (int i = 0; i < 250; i++)
+	async.print(t, i);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  async.flush();
+
+  std::multiset<std::string> expected;
+  for (int t = 0; t < 4; t++) {
+    for (int i = 0; i < 250; i++)
+      expected.insert(std::to_string(t) + " " + std::to_string(i));
+  }
+  std::multiset<std::string> lines;
+  std::string line;
+  while (std::getline(stream, line))
+    lines.insert(line);
+
+  REQUIRE(lines == expected);
+  REQUIRE(async.dropped() == 0);
+}
+
+TEST_CASE("Async print drops messages when the queue is full (line_terminator = '\n', indent = 2)",
+	  "[async]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  pprint::AsyncPrinter async(printer, 4, pprint::OverflowPolicy::drop);
+
+  auto entered = std::make_shared<std::promise<void>>();
+  std::promise<void> open;
+  async.print(Gate{entered, open.get_future().share()});
+  // The gate keeps its slot while it is printed, leaving room for three
+  entered->get_future().wait();
+  for (int i = 0; i < 10; i++)
+    async.print(i);
+  open.set_value();
+  async.flush();
+
+  const std::string expected = "gate\n0\n1\n2\n";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(async.dropped() == 7);
+}
+
+TEST_CASE("Async print samples messages when the queue is full (line_terminator = '\n', indent = 2)",
+	  "[async]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  pprint::AsyncPrinter async(printer, 4, pprint::OverflowPolicy::sample, 3);
+
+  auto entered = std::make_shared<std::promise<void>>();
+  std::promise<void> open;
+  async.print(Gate{entered, open.get_future().share()});
+  entered->get_future().wait();
+  // Opens the gate once the first two messages that find the queue full
+  // have been dropped; the third one waits for room
+  std::thread opener([&] {
+    while (async.dropped() < 2)
+      std::this_thread::yield();
+    open.set_value();
+  });
+  for (int i = 0; i < 8; i++)
+    async.print(i);
+  opener.join();
+  async.flush();
+
+  const std::string expected = "gate\n0\n1\n2\n5\n6\n7\n";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(async.dropped() == 2);
+}
@@ -0,0 +1,257 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+#include <thread>
+
+enum binary_color { binary_red, binary_green };
+
+struct Opaque {};
+
+// Prints the same arguments directly through one printer and deferred
+// through a binary logger on another with the same settings
+struct binary_pair {
+  std::stringstream direct_stream;
+  std::stringstream deferred_stream;
+  pprint::PrettyPrinter direct{direct_stream};
+  pprint::PrettyPrinter deferred{deferred_stream};
+  pprint::BinaryLogger logger{deferred};
+
+  template <typename... Targs>
+  void print(const Targs&... Fargs) {
+    direct.print(Fargs...);
+    logger.print(Fargs...);
+  }
+
+  template <typename... Targs>
+  void print_inline(const Targs&... Fargs) {
+    direct.print_inline(Fargs...);
+    logger.print_inline(Fargs...);
+  }
+};
+
+TEST_CASE("Binary log prints like print (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  binary_pair printers;
+  printers.print(1, 2.5, 3.5f, "abc", std::string("def"), std::string_view("ghi"), 'c', true, nullptr);
+  printers.print(std::vector<int>{1, 2, 3});
+  printers.print(std::vector<std::vector<int>>{{1, 2}, {3}});
+  printers.print(std::vector<std::vector<int>>{{1, 2}});
+  printers.print(std::map<std::string, std::vector<int>>{{"a", {1}}, {"b", {}}});
+  printers.print(std::map<std::string, std::vector<int>>{{"a", {1}}});
+  printers.print(std::set<int>{3, 1, 2}, std::optional<int>(), std::optional<int>(4));
+  printers.print(std::variant<int, std::string>("x"), std::make_tuple(1, "a", 2.5), std::make_pair('a', 2));
+  printers.print(binary_green, Opaque{}, std::complex<double>(1, 2));
+  printers.print(std::stack<int>({1, 2, 3}));
+  printers.print(std::priority_queue<int>(std::less<int>(), {2, 5, 1}), std::queue<int>({1, 2}));
+  printers.print(std::vector<bool>{true, false}, std::array<float, 3>{1, 2, 3});
+  printers.print(static_cast<unsigned char>(7), static_cast<short>(-3), 5ull, -7ll);
+  printers.print(std::vector<std::optional<std::vector<int>>>{std::vector<int>{1}});
+  printers.print_inline(std::list<std::string>{"a", "b"}, 1);
+  printers.logger.flush();
+
+  REQUIRE(printers.deferred_stream.str() == printers.direct_stream.str());
+}
+
+TEST_CASE("Binary log renders with the printer's settings (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  binary_pair printers;
+  for (pprint::PrettyPrinter * printer : {&printers.direct, &printers.deferred})
+    printer->quotes(true).compact(true).max_elements(2, 1).max_string_length(3);
+  printers.direct_stream << std::showpos;
+  printers.deferred_stream << std::showpos;
+  printers.print(std::vector<int>{1, 2, 3, 4, 5}, std::unordered_set<int>{1, 2, 3, 4});
+  printers.print(std::deque<std::string>{"abcdef", "x", "y", "z"}, 'q');
+  printers.print(static_cast<std::uint16_t>(4), static_cast<std::uint32_t>(5), -6);
+  printers.logger.flush();
+
+  REQUIRE(printers.deferred_stream.str() == printers.direct_stream.str());
+}
+
+TEST_CASE("Binary log records of one shape with different values (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  binary_pair printers;
+  typedef std::variant<int, std::string, std::vector<int>> alternatives;
+  printers.print(alternatives(std::vector<int>{1, 2, 3}), std::optional<std::string>("long enough to allocate"));
+  printers.print(alternatives("abc"), std::optional<std::string>());
+  printers.print(alternatives(4), std::optional<std::string>("x"));
+  printers.print(alternatives(std::vector<int>{}), std::optional<std::string>("y"));
+  for (int i = 3; i >= 0; i--)
+    printers.print(std::map<int, std::vector<std::string>>{{i, std::vector<std::string>(i, "z")}, {-i, {}}});
+  printers.logger.flush();
+
+  REQUIRE(printers.deferred_stream.str() == printers.direct_stream.str());
+}
+
+TEST_CASE("Binary log descriptors get distinct ids (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  auto& registry = pprint::detail::binary_descriptor_registry::instance();
+  const std::uint64_t first = registry.add("descriptor test: first");
+  const std::uint64_t second = registry.add("descriptor test: second");
+
+  REQUIRE(second != first);
+  REQUIRE(registry.add("descriptor test: first") == first);
+  REQUIRE(registry.find(first) == "descriptor test: first");
+  REQUIRE(registry.find(second) == "descriptor test: second");
+}
+
+TEST_CASE("Binary log keeps the byte budget (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  binary_pair printers;
+  printers.direct.max_bytes(16);
+  printers.deferred.max_bytes(16);
+  printers.print(std::vector<int>(100, 12345), 1, 2);
+  printers.print("one", "two", std::vector<std::string>(10, "three"), "four");
+  printers.logger.flush();
+
+  REQUIRE(printers.deferred_stream.str() == printers.direct_stream.str());
+}
+
+TEST_CASE("Binary log written to a stream and printed later (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  std::stringstream log;
+  {
+    pprint::BinaryLogger logger(printer);
+    logger.print("first", std::vector<int>{1, 2});
+    logger.print("second", 2.5);
+    logger.write(log);
+    logger.print("third", std::map<int, char>{{3, 'c'}});
+    logger.write(log);
+  }
+
+  REQUIRE(stream.str().empty());
+  REQUIRE(pprint::print_binary_log(log, printer));
+
+  const std::string expected = "first [1, 2]\nsecond 2.5\nthird {3 : c}\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Binary log rejects a malformed log (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  std::stringstream log;
+  pprint::BinaryLogger logger(printer);
+  logger.print(std::vector<std::string>{"a", "b"});
+  logger.write(log);
+  const std::string bytes = log.str();
+
+  std::stringstream truncated(bytes.substr(0, bytes.size() - 3));
+  REQUIRE_FALSE(pprint::print_binary_log(truncated, printer));
+  std::stringstream garbage("PPBL\x7f garbage");
+  REQUIRE_FALSE(pprint::print_binary_log(garbage, printer));
+  REQUIRE(stream.str().empty());
+}
+
+TEST_CASE("Binary log from several threads in call order (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  pprint::BinaryLogger logger(printer);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&logger, t] {
+      for (int i = 0; i < 250; i++)
+	logger.print(t, i);
+    });
+  }
+  // Drains while the threads log
+  for (int i = 0; i < 10; i++)
+    logger.flush();
+  for (auto& thread : threads)
+    thread.join();
+  logger.flush();
+
+  std::vector<int> next(4, 0);
+  size_t lines = 0;
+  int t, i;
+  while (stream >> t >> i) {
+    REQUIRE(i == next[t]);
+    next[t] += 1;
+    lines += 1;
+  }
+
+  REQUIRE(lines == 1000);
+}
+
+TEST_CASE("Binary log from threads that have ended (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  binary_pair printers;
+
+  // Threads that end before and after a drain, some of which may get the
+  // ID of one that ended earlier
+  for (int t = 0; t < 20; t++) {
+    printers.direct.print(t, std::vector<int>(t % 3, t));
+    std::thread([&printers, t] { printers.logger.print(t, std::vector<int>(t % 3, t)); }).join();
+    if (t % 4 == 0)
+      printers.logger.flush();
+  }
+  printers.print("main");
+  printers.logger.flush();
+  printers.logger.flush();
+  printers.print("after");
+  printers.logger.flush();
+
+  REQUIRE(printers.deferred_stream.str() == printers.direct_stream.str());
+}
+
+TEST_CASE("Record stream prints like print (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  std::stringstream direct_stream;
+  std::stringstream text;
+  pprint::PrettyPrinter direct(direct_stream);
+  pprint::PrettyPrinter printer(text);
+  std::stringstream log;
+  {
+    pprint::RecordStream records(log, printer);
+    for (int i = 0; i < 3; i++) {
+      const auto record = std::make_tuple(i, i * 0.5, std::string(i, 'x'));
+      direct.print(record);
+      records.print(record);
+      const std::map<std::string, std::vector<int>> shape {{"a", {i}}, {"b", {}}};
+      direct.print("shape", shape);
+      records.print("shape", shape);
+    }
+    direct.print_inline(binary_green, Opaque{});
+    records.print_inline(binary_green, Opaque{});
+  }
+
+  REQUIRE(text.str().empty());
+  REQUIRE(pprint::print_binary_log(log, printer));
+  REQUIRE(text.str() == direct_stream.str());
+}
+
+TEST_CASE("Record stream writes each descriptor once per segment (line_terminator = '\n', indent = 2)",
+	  "[binary]") {
+  std::stringstream text;
+  pprint::PrettyPrinter printer(text);
+  printer.compact(true);
+  std::stringstream log;
+  pprint::RecordStream records(log, printer);
+  std::vector<size_t> sizes;
+  for (int i = 0; i < 3; i++) {
+    records.print(std::make_pair(i, i));
+    records.flush();
+    sizes.push_back(log.str().size());
+  }
+  // 'R', the descriptor number, the payload size and two 4-byte ints
+  REQUIRE(sizes[2] - sizes[1] == 11);
+  REQUIRE(sizes[1] - sizes[0] == 11);
+
+  // Unclosed, the segment is printed up to its last record
+  std::stringstream unclosed(log.str());
+  REQUIRE_FALSE(pprint::print_binary_log(unclosed, printer));
+  REQUIRE(text.str() == "(0, 0)\n(1, 1)\n(2, 2)\n");
+
+  // A new segment repeats the descriptor
+  records.close();
+  records.print(std::make_pair(3, 3));
+  records.close();
+  text.str("");
+  REQUIRE(pprint::print_binary_log(log, printer));
+  REQUIRE(text.str() == "(0, 0)\n(1, 1)\n(2, 2)\n(3, 3)\n");
+}
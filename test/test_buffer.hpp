@@ -0,0 +1,118 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+TEST_CASE("Print flushes before returning (line_terminator = '\n', indent = 2)",
+	  "[buffer]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.print(std::vector<int>{1, 2});
+  stream << "between\n";
+  printer.print("A", "B");
+
+  const std::string expected = "[1, 2]\nbetween\nA B\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print output larger than the flush threshold (line_terminator = '\n', indent = 2)",
+	  "[buffer]") {
+  std::vector<std::string> foo(20000, "pprint");
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.print(foo);
+
+  std::string expected = "[";
+  for (size_t i = 0; i < foo.size(); i++) {
+    expected += (i == 0 ? "" : ", ");
+    expected += foo[i];
+  }
+  expected += "]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print uses the formatting flags of the stream (line_terminator = '\n', indent = 2)",
+	  "[buffer]") {
+  std::stringstream stream;
+  stream << std::hex;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(255);
+
+  const std::string expected = "ff\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print null C string (line_terminator = '\n', indent = 2)",
+	  "[buffer]") {
+  const char * foo = nullptr;
+  std::vector<const char *> bar {"a", nullptr};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.print(foo);
+  printer.print(bar);
+  printer.quotes(true);
+  printer.print(foo, bar);
+
+  const std::string expected = "nullptr\n[a, nullptr]\nnullptr [\"a\", nullptr]\n";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(stream.good());
+}
+
+// Stream buffer that takes no bytes
+struct RejectingBuffer : std::streambuf {
+  int_type overflow(int_type value) override {
+    return traits_type::eof();
+  }
+};
+
+TEST_CASE("Print reports a failing stream to the caller (line_terminator = '\n', indent = 2)",
+	  "[buffer]") {
+  RejectingBuffer buffer;
+  std::ostream stream(&buffer);
+  stream.exceptions(std::ios_base::badbit);
+  pprint::PrettyPrinter printer(stream);
+  REQUIRE_THROWS_AS(printer.print(std::vector<int>{1, 2}), std::ios_base::failure);
+  REQUIRE(stream.bad());
+
+  stream.exceptions(std::ios_base::goodbit);
+  stream.clear();
+  printer.print("foo");
+  REQUIRE(stream.bad());
+}
+
+// String buffer that counts how often it is flushed
+struct SyncCountingBuffer : std::stringbuf {
+  int syncs = 0;
+
+  int sync() override {
+    syncs += 1;
+    return std::stringbuf::sync();
+  }
+};
+
+TEST_CASE("Print flushes the tied stream first (line_terminator = '\n', indent = 2)",
+	  "[buffer]") {
+  SyncCountingBuffer tied_buffer;
+  std::ostream tied(&tied_buffer);
+  std::stringstream stream;
+  stream.tie(&tied);
+  pprint::PrettyPrinter printer(stream);
+  printer.print(1);
+  REQUIRE(tied_buffer.syncs == 1);
+
+  SyncCountingBuffer unitbuf_buffer;
+  std::ostream unitbuf_stream(&unitbuf_buffer);
+  unitbuf_stream << std::unitbuf;
+  pprint::PrettyPrinter unitbuf_printer(unitbuf_stream);
+  unitbuf_printer.print(1);
+  REQUIRE(unitbuf_buffer.syncs == 1);
+  REQUIRE(unitbuf_buffer.str() == "1\n");
+}
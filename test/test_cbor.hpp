@@ -0,0 +1,134 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+enum cbor_color { cbor_red, cbor_green };
+
+struct CborOpaque {};
+
+// CBOR encoding of `value`, as a string of bytes
+template <typename T>
+inline std::string cbor_bytes(const T& value) {
+  std::stringstream stream;
+  pprint::CborPrinter cbor(stream);
+  cbor.print(value);
+  return stream.str();
+}
+
+// Text that print_cbor prints for `bytes`, or "malformed"
+inline std::string cbor_text(const std::string& bytes) {
+  std::stringstream in(bytes);
+  std::stringstream out;
+  pprint::PrettyPrinter printer(out);
+  printer.compact(true);
+  if (!pprint::print_cbor(in, printer))
+    return "malformed";
+  return out.str();
+}
+
+TEST_CASE("Print scalars as CBOR",
+	  "[cbor]") {
+  REQUIRE(cbor_bytes(5) == "\x05");
+  REQUIRE(cbor_bytes(500) == std::string("\x19\x01\xf4", 3));
+  REQUIRE(cbor_bytes(-3) == "\x22");
+  REQUIRE(cbor_bytes(true) == "\xf5");
+  REQUIRE(cbor_bytes(nullptr) == "\xf6");
+  REQUIRE(cbor_bytes(std::optional<int>()) == "\xf7");
+  REQUIRE(cbor_bytes(1.5f) == std::string("\xfa\x3f\xc0\x00\x00", 5));
+  REQUIRE(cbor_bytes(1.5) == std::string("\xfb\x3f\xf8\x00\x00\x00\x00\x00\x00", 9));
+  REQUIRE(cbor_bytes("abc") == "\x63" "abc");
+  REQUIRE(cbor_bytes(std::string("\xff")) == "\x41\xff");
+  REQUIRE(cbor_bytes(cbor_green) == "\x6a" "cbor_green");
+  REQUIRE(cbor_bytes(std::numeric_limits<std::int64_t>::min()) == "\x3b\x7f\xff\xff\xff\xff\xff\xff\xff");
+}
+
+TEST_CASE("Print containers as CBOR",
+	  "[cbor]") {
+  REQUIRE(cbor_bytes(std::vector<std::string>{"a", "b"}) == "\x82\x61" "a" "\x61" "b");
+  REQUIRE(cbor_bytes(std::set<bool>{true}) == "\xd9\x01\x02\x81\xf5");
+  REQUIRE(cbor_bytes(std::map<std::string, bool>{{"a", false}}) == "\xa1\x61" "a" "\xf4");
+  REQUIRE(cbor_bytes(std::make_pair('x', nullptr)) == "\x82\x61" "x" "\xf6");
+  REQUIRE(cbor_bytes(std::stack<bool>({true, false})) == "\x82\xf4\xf5");
+}
+
+TEST_CASE("Print contiguous numbers as CBOR typed arrays",
+	  "[cbor]") {
+  const std::vector<std::int32_t> values {1, -2, 3};
+  // sint32, in the byte order of this machine
+  const char tag = pprint::detail::is_little_endian() ? '\x4e' : '\x4a';
+  std::string expected = std::string("\xd8") + tag + "\x4c";
+  expected.append(reinterpret_cast<const char *>(values.data()), 12);
+
+  REQUIRE(cbor_bytes(values) == expected);
+  REQUIRE(cbor_bytes(std::array<std::uint8_t, 2>{1, 2}) == "\xd8\x40\x42\x01\x02");
+  REQUIRE(cbor_text(cbor_bytes(std::vector<double>{1.5, -2})) == "[1.5, -2]\n");
+  REQUIRE(cbor_text(cbor_bytes(std::vector<float>{0.5f})) == "[0.5f]\n");
+  REQUIRE(cbor_text(cbor_bytes(std::vector<std::uint16_t>{})) == "[]\n");
+}
+
+TEST_CASE("Print CBOR like print (line_terminator = '\n', indent = 2)",
+	  "[cbor]") {
+  std::stringstream direct_stream;
+  std::stringstream cbor_stream;
+  pprint::PrettyPrinter direct(direct_stream);
+  pprint::CborPrinter cbor(cbor_stream);
+  auto print = [&](const auto& value) {
+    direct.print(value);
+    cbor.print(value);
+  };
+  print(1);
+  print(-2.5);
+  print(std::string("abc"));
+  print(std::vector<int>{1, 2, 3});
+  print(std::vector<std::vector<int>>{{1, 2}, {3}});
+  print(std::map<std::string, std::vector<int>>{{"a", {1}}, {"b", {}}});
+  print(std::set<int>{3, 1, 2});
+  print(std::optional<int>());
+  print(std::vector<std::optional<int>>{4, std::nullopt});
+  print(std::variant<int, std::string>("x"));
+  print(std::vector<bool>{true, false});
+  print(cbor_green);
+  print(CborOpaque{});
+  print(nullptr);
+  print(std::numeric_limits<std::uint64_t>::max());
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef __int128 int128;
+  print(-(static_cast<int128>(1) << 100));
+#endif
+
+  std::stringstream text;
+  pprint::PrettyPrinter printer(text);
+  REQUIRE(pprint::print_cbor(cbor_stream, printer));
+  REQUIRE(text.str() == direct_stream.str());
+}
+
+TEST_CASE("Read CBOR from other encoders",
+	  "[cbor]") {
+  // Indefinite-length array, string and map
+  REQUIRE(cbor_text("\x9f\x01\x7f\x62" "ab" "\x61" "c" "\xff\xff") == "[1, abc]\n");
+  REQUIRE(cbor_text("\xbf\x61" "a" "\x01\xff") == "{a : 1}\n");
+  // Half floats, an unknown tag (an epoch date) and a simple value
+  REQUIRE(cbor_text(std::string("\xf9\x3e\x00", 3)) == "1.5f\n");
+  REQUIRE(cbor_text("\xc1\x1a\x51\x4b\x67\xb0") == "1363896240\n");
+  REQUIRE(cbor_text("\xf0") == "simple(16)\n");
+  // Bignums, and the most negative 64-bit argument
+  REQUIRE(cbor_text(std::string("\xc2\x49\x01\x00\x00\x00\x00\x00\x00\x00\x00", 11)) == "18446744073709551616\n");
+  REQUIRE(cbor_text("\x3b\xff\xff\xff\xff\xff\xff\xff\xff") == "-18446744073709551616\n");
+  // A big-endian uint16 typed array
+  REQUIRE(cbor_text(std::string("\xd8\x41\x44\x01\x02\x00\x03", 7)) == "[258, 3]\n");
+}
+
+TEST_CASE("Reject malformed CBOR",
+	  "[cbor]") {
+  REQUIRE(cbor_text("\x83\x01\x02") == "malformed");                  // Truncated array
+  REQUIRE(cbor_text("\x9b\xff\xff\xff\xff\xff\xff\xff\xff") == "malformed"); // Count past the end
+  REQUIRE(cbor_text("\x1c") == "malformed");                          // Reserved argument
+  REQUIRE(cbor_text("\xff") == "malformed");                          // Stray break
+  REQUIRE(cbor_text("\xd8\x4e\x43\x01\x02\x03") == "malformed");      // Typed array of 3 bytes
+  REQUIRE(cbor_text(std::string(1000, '\x81')) == "malformed");       // Nested too deep
+
+  size_t position = 1;
+  pprint::DynamicValue value;
+  REQUIRE_FALSE(pprint::decode_cbor("\x01\x62" "a", position, value));
+  REQUIRE(position == 1);
+}
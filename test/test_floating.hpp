@@ -0,0 +1,69 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+TEST_CASE("Print shortest round-trip floats (line_terminator = '\n', indent = 2)",
+	  "[floating]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(3.14f, 2.718, 0.1, 1.0f / 3, 1e20, 100.0);
+
+  const std::string expected = "3.14f 2.718 0.1 0.33333334f 1e+20 100\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print floats in fixed and scientific notation (line_terminator = '\n', indent = 2)",
+	  "[floating]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.float_format(pprint::FloatFormat::fixed).precision(2);
+  printer.print(3.14159f, -2.5);
+  printer.float_format(pprint::FloatFormat::scientific);
+  printer.print(1234.5, 0.0f);
+
+  const std::string expected = "3.14f -2.50\n1.23e+03 0.00e+00f\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print hexadecimal floats (line_terminator = '\n', indent = 2)",
+	  "[floating]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.float_format(pprint::FloatFormat::hex);
+  printer.print(1.0, -3.0f, 0.5);
+
+  const std::string expected = "0x1p+0 -0x1.8p+1f 0x1p-1\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print vector of doubles (line_terminator = '\n', indent = 2)",
+	  "[floating]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(std::vector<double>{0.5, -1.25, 1e-7});
+
+  const std::string expected = "[\n"
+    "  0.5, \n"
+    "  -1.25, \n"
+    "  1e-07"
+    "\n]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print float matrix (line_terminator = '\n', indent = 2)",
+	  "[floating]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(std::array<std::array<float, 3>, 2>{{{1.5f, 2, 3}, {4, 5, 6.25f}}});
+
+  const std::string expected = "[\n"
+    "  [1.5f, 2f, 3f], \n"
+    "  [4f, 5f, 6.25f]"
+    "\n]\n";
+
+  REQUIRE(stream.str() == expected);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+#include <system_error>
+
+struct Point {
+  int x, y;
+};
+
+struct Polygon {
+  std::string name;
+  std::vector<Point> points;
+};
+
+// operator<< is ignored in favor of the formatter
+std::ostream& operator<<(std::ostream& os, const Polygon&) {
+  return os << "unused";
+}
+
+namespace pprint {
+
+  template <>
+  struct formatter<Point> {
+    void format(const Point& point, format_context& context) const {
+      context.write("Point(");
+      context.print(point.x);
+      context.write(", ");
+      context.print(point.y);
+      context.write(")");
+    }
+  };
+
+  template <>
+  struct formatter<Polygon> {
+    void format(const Polygon& polygon, format_context& context) const {
+      context.write("Polygon ");
+      context.print(polygon.name);
+      context.write(" ");
+      context.print(polygon.points);
+    }
+  };
+
+}
+
+TEST_CASE("Print type with formatter (line_terminator = '\n', indent = 2)",
+	  "[formatter]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(Point{1, 2});
+
+  const std::string expected = "Point(1, 2)\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print vector of types with formatter (line_terminator = '\n', indent = 2)",
+	  "[formatter]") {
+  std::vector<Point> foo {{1, 2}, {3, 4}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(foo);
+
+  const std::string expected = "[\n  Point(1, 2), \n  Point(3, 4)\n]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print nested values from formatter (line_terminator = '\n', indent = 2)",
+	  "[formatter]") {
+  Polygon foo {"triangle", {{0, 0}, {1, 0}, {0, 1}}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.quotes(true);
+  printer.print(foo);
+
+  const std::string expected = "Polygon \"triangle\" [Point(0, 0), Point(1, 0), Point(0, 1)]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Categorize types (line_terminator = '\n', indent = 2)",
+	  "[formatter]") {
+  using pprint::detail::category;
+  using pprint::detail::category_v;
+  static_assert(category_v<int> == category::scalar);
+  static_assert(category_v<std::string_view> == category::string);
+  static_assert(category_v<std::vector<int>> == category::range);
+  static_assert(category_v<std::map<int, int>> == category::map);
+  static_assert(category_v<std::pair<int, int>> == category::tuple);
+  static_assert(category_v<std::shared_ptr<int>> == category::pointer);
+  static_assert(category_v<Point> == category::formatted);
+  static_assert(category_v<std::error_code> == category::streamable);
+  REQUIRE(category_v<std::string> == category::string);
+}
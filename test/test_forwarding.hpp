@@ -0,0 +1,92 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+// Element type that counts how often it is copied while being printed
+struct Instrumented {
+  static size_t copies;
+  int value;
+
+  Instrumented(int v) : value(v) {}
+  Instrumented(const Instrumented& other) : value(other.value) { copies += 1; }
+  Instrumented& operator=(const Instrumented& other) {
+    value = other.value;
+    copies += 1;
+    return *this;
+  }
+};
+
+size_t Instrumented::copies = 0;
+
+std::ostream& operator<<(std::ostream& os, const Instrumented& instrumented) {
+  return os << instrumented.value;
+}
+
+TEST_CASE("Print does not copy its argument (line_terminator = '\n', indent = 2)",
+	  "[forwarding]") {
+  std::vector<Instrumented> foo {1, 2, 3};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  Instrumented::copies = 0;
+  printer.print(foo);
+
+  const std::string expected = "[1, 2, 3]\n";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(Instrumented::copies == 0);
+}
+
+TEST_CASE("Variadic print does not copy its arguments (line_terminator = '\n', indent = 2)",
+	  "[forwarding]") {
+  std::vector<Instrumented> foo {1, 2};
+  Instrumented bar {3};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  Instrumented::copies = 0;
+  printer.print(foo, bar, foo, "end");
+
+  const std::string expected = "[1, 2]\n 3 [1, 2]\n end\n";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(Instrumented::copies == 0);
+}
+
+TEST_CASE("Variadic print_inline does not copy its arguments (line_terminator = '\n', indent = 2)",
+	  "[forwarding]") {
+  Instrumented foo {1};
+  Instrumented bar {2};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  Instrumented::copies = 0;
+  printer.print_inline(foo, bar);
+
+  const std::string expected = "  1   2";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(Instrumented::copies == 0);
+}
+
+TEST_CASE("Print does not copy pair, optional and variant contents (line_terminator = '\n', indent = 2)",
+	  "[forwarding]") {
+  std::pair<int, std::vector<Instrumented>> foo {1, {2, 3}};
+  std::optional<std::vector<Instrumented>> bar {std::vector<Instrumented>{4, 5}};
+  std::variant<int, std::vector<Instrumented>> baz {std::vector<Instrumented>{6, 7}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  Instrumented::copies = 0;
+  printer.print(foo);
+  printer.print(bar);
+  printer.print(baz);
+
+  const std::string expected = "(1, [2, 3])\n[4, 5]\n[6, 7]\n";
+
+  REQUIRE(stream.str() == expected);
+  REQUIRE(Instrumented::copies == 0);
+}
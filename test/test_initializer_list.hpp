@@ -0,0 +1,52 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+TEST_CASE("Print initializer list in given order (line_terminator = '\n', indent = 2)",
+	  "[std::initializer_list]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.print({3, 1, 2, 1});
+  printer.print({std::string("b"), std::string("a")});
+
+  const std::string expected = "{3, 1, 2, 1}\n{b, a}\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print sorted initializer list (line_terminator = '\n', indent = 2)",
+	  "[std::initializer_list]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.sort_initializer_lists(true);
+  printer.print({3, 1, 2, 1});
+
+  const std::string expected = "{\n"
+    "  1, \n"
+    "  1, \n"
+    "  2, \n"
+    "  3"
+    "\n}\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print initializer list nested in a container (line_terminator = ';\n', indent = 2)",
+	  "[std::initializer_list]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.line_terminator(";\n");
+  printer.print(std::vector<std::initializer_list<int>>{{3, 1}, {2}});
+  printer.sort_initializer_lists(true);
+  printer.print(std::vector<std::initializer_list<int>>{{3, 1}, {2}});
+  printer.print(std::initializer_list<int>{3, 1}, 5);
+
+  // A nested list ends where its brackets do; only the top level ends the line
+  const std::string expected = "[{3, 1}, {2}];\n"
+    "[{1, 3}, {2}];\n"
+    "{1, 3};\n 5;\n";
+
+  REQUIRE(stream.str() == expected);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+#include <cstdint>
+#include <limits>
+
+TEST_CASE("Print 8-bit integers as numbers (line_terminator = '\n', indent = 2)",
+	  "[integer]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.print(std::int8_t{-65}, std::uint8_t{66}, std::vector<std::uint8_t>{0, 255});
+
+  const std::string expected = "-65 66 [0, 255]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print integer limits (line_terminator = '\n', indent = 2)",
+	  "[integer]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print((std::numeric_limits<std::int64_t>::min)(), (std::numeric_limits<std::int64_t>::max)(),
+		(std::numeric_limits<std::uint64_t>::max)(), std::int16_t{0}, -7);
+
+  const std::string expected = "-9223372036854775808 9223372036854775807 18446744073709551615 0 -7\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+#ifdef __SIZEOF_INT128__
+TEST_CASE("Print 128-bit integers (line_terminator = '\n', indent = 2)",
+	  "[integer]") {
+  const unsigned __int128 max = ~static_cast<unsigned __int128>(0);
+  const __int128 min = -static_cast<__int128>(max >> 1) - 1;
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(max, min, static_cast<__int128>(42));
+
+  const std::string expected = "340282366920938463463374607431768211455 "
+    "-170141183460469231731687303715884105728 42\n";
+
+  REQUIRE(stream.str() == expected);
+}
+#endif
@@ -0,0 +1,147 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+#include <cmath>
+
+enum json_color { json_red, json_green };
+
+struct JsonOpaque {};
+
+TEST_CASE("Print scalars as JSON",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  json.print(5);
+  json.print(-3ll);
+  json.print(true);
+  json.print(2.5);
+  json.print(0.1f);
+  json.print('c');
+  json.print(nullptr);
+  json.print(json_green);
+  json.print(std::complex<double>(1, -2));
+
+  const std::string expected = "5\n-3\ntrue\n2.5\n0.1\n\"c\"\nnull\n\"json_green\"\n[1,-2]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print non-finite numbers as JSON null",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  json.print(std::vector<double>{std::nan(""), HUGE_VAL, -HUGE_VAL, -0.0});
+
+  const std::string expected = "[null,null,null,-0]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print strings as JSON",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  json.print("say \"hi\"\\");
+  json.print(std::string("tab\tline\nbell\x07" "del\x7f"));
+  json.print(std::string_view("caf\xc3\xa9 \xf0\x9f\x98\x80"));
+  const char * null = nullptr;
+  json.print(null);
+
+  const std::string expected = "\"say \\\"hi\\\"\\\\\"\n"
+    "\"tab\\tline\\nbell\\u0007del\x7f\"\n"
+    "\"caf\xc3\xa9 \xf0\x9f\x98\x80\"\n"
+    "null\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print invalid UTF-8 as JSON replacement characters",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  // A stray continuation byte, an overlong form, a surrogate and a
+  // truncated sequence
+  json.print(std::string("a\x80 \xc0\xaf \xed\xa0\x80 \xe2\x82"));
+
+  const std::string expected = "\"a\\ufffd \\ufffd\\ufffd \\ufffd\\ufffd\\ufffd \\ufffd\\ufffd\"\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print long strings as JSON",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  // The UTF-8 sequence and the escapes straddle the slices the string is
+  // escaped in
+  const std::string value = std::string(4095, 'a') + "\xc3\xa9" + std::string(5000, '"');
+  json.print(value);
+
+  std::string expected = "\"" + std::string(4095, 'a') + "\xc3\xa9";
+  for (int i = 0; i < 5000; i++)
+    expected += "\\\"";
+  expected += "\"\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print containers as JSON",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  json.print(std::vector<int>{1, 2, 3});
+  json.print(std::vector<std::vector<int>>{{1}, {}});
+  json.print(std::set<std::string>{"b", "a"});
+  json.print(std::array<bool, 2>{true, false});
+  json.print(std::vector<bool>{false, true});
+  json.print(std::stack<int>({1, 2, 3}));
+  json.print(std::queue<int>({1, 2, 3}));
+  json.print(std::priority_queue<int>(std::less<int>(), {2, 3, 1}));
+
+  const std::string expected = "[1,2,3]\n[[1],[]]\n[\"a\",\"b\"]\n[true,false]\n[false,true]\n"
+    "[3,2,1]\n[1,2,3]\n[3,2,1]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print maps as JSON",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  json.print(std::map<std::string, std::vector<int>>{{"a", {1}}, {"b\n", {}}});
+  json.print(std::map<int, double>{{1, 1.5}, {-2, 2}});
+  json.print(std::map<json_color, bool>{{json_red, true}});
+  json.print(std::multimap<std::string, int>{{"a", 1}, {"a", 2}});
+  json.print(std::map<std::pair<int, int>, int>{{{1, 2}, 3}});
+
+  const std::string expected = "{\"a\":[1],\"b\\n\":[]}\n{\"-2\":2,\"1\":1.5}\n{\"json_red\":true}\n"
+    "[[\"a\",1],[\"a\",2]]\n[[[1,2],3]]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print tuples, optionals and variants as JSON",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  json.print(std::make_tuple(1, "a", std::optional<int>(), std::optional<int>(2)));
+  json.print(std::make_pair(std::string("x"), 2.5));
+  json.print(std::variant<int, std::string>("v"));
+  json.print(std::vector<std::variant<int, bool>>{1, true});
+
+  const std::string expected = "[1,\"a\",null,2]\n[\"x\",2.5]\n\"v\"\n[1,true]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print values without a JSON form as strings",
+	  "[json]") {
+  std::stringstream stream;
+  pprint::JsonPrinter json(stream);
+  int * null = nullptr;
+  json.print(std::make_tuple(JsonOpaque{}, null));
+
+  const std::string expected = "[\"<Object JsonOpaque>\",null]\n";
+
+  REQUIRE(stream.str() == expected);
+}
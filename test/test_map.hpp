@@ -0,0 +1,49 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+TEST_CASE("Compact Print map of four elements (line_terminator = '\n', indent = 2)",
+	  "[std::map]") {
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.print(std::map<int, std::string>{{1, "a"}, {2, "b"}, {3, "c"}, {4, "d"}});
+  printer.print(std::vector<std::map<int, int>>{{{1, 2}, {3, 4}, {5, 6}}});
+
+  // No indentation before the keys between the first and the last
+  const std::string expected = "{1 : a, 2 : b, 3 : c, 4 : d}\n"
+    "[{1 : 2, 3 : 4, 5 : 6}]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print map nested in a map (line_terminator = '\n', indent = 2)",
+	  "[std::map]") {
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(std::map<int, std::map<int, int>>{{1, {{1, 2}, {3, 4}, {5, 6}}}});
+
+  const std::string expected = "{1 : {1 : 2, 3 : 4, 5 : 6}"
+    "\n}\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print map of vectors inline (line_terminator = '\n', indent = 2)",
+	  "[std::map]") {
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print_inline(std::map<int, std::vector<int>>{{1, {2}}, {3, {4}}});
+
+  // The closing bracket goes on a line of its own, at the indentation of
+  // the call, with no trailing spaces before it
+  const std::string expected = "{\n"
+    "    1 : [2], \n"
+    "    3 : [4]"
+    "\n  }\n";
+
+  REQUIRE(stream.str() == expected);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+inline constexpr std::string_view policy_crlf = "\r\n";
+
+struct Rgb {
+  int r, g, b;
+};
+
+namespace pprint {
+
+  template <>
+  struct formatter<Rgb> {
+    template <typename Context>
+    void format(const Rgb& color, Context& context) const {
+      context.write("rgb");
+      context.print(std::make_tuple(color.r, color.g, color.b));
+    }
+  };
+
+}
+
+TEST_CASE("Static policy prints like the default printer (line_terminator = '\n', indent = 2)",
+	  "[policy]") {
+  std::map<std::string, std::vector<int>> foo {{"a", {1, 2}}, {"b", {}}};
+
+  std::stringstream expected;
+  pprint::PrettyPrinter runtime(expected);
+  runtime.print(foo);
+  runtime.print("x", 1, 2.5, std::vector<std::string>{"y"});
+  runtime.print(std::stack<int>({1, 2, 3}));
+
+  std::stringstream stream;
+  pprint::BasicPrinter<pprint::StaticPolicy<>> printer(stream);
+  printer.print(foo);
+  printer.print("x", 1, 2.5, std::vector<std::string>{"y"});
+  printer.print(std::stack<int>({1, 2, 3}));
+
+  REQUIRE(stream.str() == expected.str());
+}
+
+TEST_CASE("Static policy with compact and quotes (line_terminator = '\n', indent = 2)",
+	  "[policy]") {
+  std::vector<std::string> foo {"a", "b"};
+
+  std::stringstream stream;
+  pprint::BasicPrinter<pprint::StaticPolicy<true, true>> printer(stream);
+  printer.print(foo);
+  printer.print(std::vector<double>{1.5, 2.5});
+
+  const std::string expected = "[\"a\", \"b\"]\n[1.5, 2.5]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Static policy with indent and line terminator (line_terminator = '\r\n', indent = 4)",
+	  "[policy]") {
+  std::stringstream stream;
+  pprint::BasicPrinter<pprint::StaticPolicy<false, false, 4, policy_crlf>> printer(stream);
+  printer.print(std::vector<int>{1, 2});
+  printer.print("a", "b");
+
+  const std::string expected = "[\n    1, \n    2\n]\r\na b\r\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Static policy keeps the other settings configurable (line_terminator = '\n', indent = 2)",
+	  "[policy]") {
+  std::stringstream stream;
+  pprint::BasicPrinter<pprint::StaticPolicy<true>> printer(stream);
+  printer.max_elements(2).precision(2).float_format(pprint::FloatFormat::fixed);
+  printer.print(std::vector<double>{1, 2, 3, 4});
+
+  const std::string expected = "[1.00, 2.00, ... (2 more)]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print formatter with generic context (line_terminator = '\n', indent = 2)",
+	  "[policy]") {
+  std::vector<Rgb> foo {{255, 0, 0}, {0, 0, 255}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter runtime(stream);
+  runtime.compact(true);
+  runtime.print(foo);
+  pprint::BasicPrinter<pprint::StaticPolicy<true>> printer(stream);
+  printer.print(foo);
+
+  const std::string expected = "[rgb(255, 0, 0), rgb(0, 0, 255)]\n"
+    "[rgb(255, 0, 0), rgb(0, 0, 255)]\n";
+
+  REQUIRE(stream.str() == expected);
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+#include <thread>
+
+TEST_CASE("Print from several threads with one printer (line_terminator = '\n', indent = 2)",
+	  "[thread]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  const pprint::PrettyPrinter& shared = printer;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&shared, t] {
+      for (int i = 0; i < 200; i++)
+	shared.print("thread", t, std::vector<int>{i, i, i});
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  std::multiset<std::string> expected;
+  for (int t = 0; t < 4; t++) {
+    for (int i = 0; i < 200; i++) {
+      const std::string n = std::to_string(i);
+      expected.insert("thread " + std::to_string(t) + " [" + n + ", " + n + ", " + n + "]");
+    }
+  }
+  std::multiset<std::string> lines;
+  std::string line;
+  while (std::getline(stream, line))
+    lines.insert(line);
+
+  REQUIRE(lines == expected);
+}
+
+TEST_CASE("Print output larger than the flush threshold from several threads (line_terminator = '\n', indent = 2)",
+	  "[thread]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&printer, t] {
+      printer.print(std::vector<int>(30000, t));
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  // Each call's output reaches the stream in one piece
+  std::multiset<std::string> expected;
+  for (int t = 0; t < 4; t++) {
+    std::string line = "[";
+    for (size_t i = 0; i < 30000; i++)
+      line += (i == 0 ? "" : ", ") + std::to_string(t);
+    expected.insert(line + "]");
+  }
+  std::multiset<std::string> lines;
+  std::string line;
+  while (std::getline(stream, line))
+    lines.insert(line);
+
+  REQUIRE(lines == expected);
+}
+
+TEST_CASE("Change settings while other threads print (line_terminator = '\n', indent = 2)",
+	  "[thread]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2; t++) {
+    threads.emplace_back([&printer] {
+      for (int i = 0; i < 500; i++)
+	printer.print(std::vector<int>{1, 2});
+    });
+  }
+  for (int i = 0; i < 500; i++)
+    printer.compact(i % 2 == 0);
+  for (auto& thread : threads)
+    thread.join();
+
+  // Every call prints with one snapshot of the settings: compact or not
+  const std::string compact = "[1, 2]\n";
+  const std::string expanded = "[\n  1, \n  2\n]\n";
+  const std::string output = stream.str();
+  size_t calls = 0;
+  for (size_t position = 0; position < output.size(); calls++) {
+    if (output.compare(position, compact.size(), compact) == 0)
+      position += compact.size();
+    else if (output.compare(position, expanded.size(), expanded) == 0)
+      position += expanded.size();
+    else
+      break;
+  }
+
+  REQUIRE(calls == 1000);
+}
+
+TEST_CASE("Print large containers in parallel (line_terminator = '\n', indent = 2)",
+	  "[thread]") {
+  std::vector<int> integers(100001);
+  for (size_t i = 0; i < integers.size(); i++)
+    integers[i] = static_cast<int>(i * 7919 % 1000003) - 500000;
+  std::vector<double> doubles(50000);
+  for (size_t i = 0; i < doubles.size(); i++)
+    doubles[i] = static_cast<double>(i) / 7.0;
+  const std::vector<float> floats(40000, 0.1f);
+  const std::vector<std::vector<double>> nested {doubles, {}, doubles};
+
+  for (size_t threads : {2, 3, 8}) {
+    for (bool compact : {false, true}) {
+      std::stringstream sequential_stream;
+      std::stringstream parallel_stream;
+      pprint::PrettyPrinter sequential(sequential_stream);
+      pprint::PrettyPrinter parallel(parallel_stream);
+      sequential.compact(compact);
+      parallel.compact(compact).parallel(1000, threads);
+      for (pprint::PrettyPrinter * printer : {&sequential, &parallel}) {
+	printer->print(integers);
+	printer->print("doubles", doubles, floats);
+	printer->print(nested);
+      }
+
+      REQUIRE(parallel_stream.str() == sequential_stream.str());
+    }
+  }
+}
+
+TEST_CASE("Print in parallel from several threads (line_terminator = '\n', indent = 2)",
+	  "[thread]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true).parallel(20000, 3);
+
+  // Each call's chunks run on the shared pool at the same time as the
+  // other calls' chunks
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&printer, t] {
+      for (int i = 0; i < 5; i++)
+	printer.print(std::vector<int>(50000, t));
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  std::multiset<std::string> expected;
+  for (int t = 0; t < 4; t++) {
+    std::string line = "[";
+    for (size_t i = 0; i < 50000; i++)
+      line += (i == 0 ? "" : ", ") + std::to_string(t);
+    for (int i = 0; i < 5; i++)
+      expected.insert(line + "]");
+  }
+  std::multiset<std::string> lines;
+  std::string line;
+  while (std::getline(stream, line))
+    lines.insert(line);
+
+  REQUIRE(lines == expected);
+}
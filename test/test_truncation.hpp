@@ -0,0 +1,170 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+TEST_CASE("Print vector with head and tail (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::vector<int> foo {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.max_elements(3, 2);
+  printer.print(foo);
+
+  const std::string expected = "[\n  0, \n  1, \n  2, \n  ... (5 more), \n  8, \n  9\n]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print compact list with head only (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::list<int> foo {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.max_elements(2);
+  printer.print(foo);
+
+  const std::string expected = "[0, 1, ... (8 more)]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print containers within limits unchanged (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::set<int> foo {1, 2, 3, 4};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.max_elements(2, 2);
+  printer.print(foo);
+
+  const std::string expected = "{1, 2, 3, 4}\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print map with head and tail (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::map<int, int> foo {{1, 1}, {2, 4}, {3, 9}, {4, 16}, {5, 25}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.max_elements(1, 1);
+  printer.print(foo);
+
+  const std::string expected = "{1 : 1, ... (3 more), 5 : 25}\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print unordered map with head only (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::unordered_map<int, int> foo {{1, 1}, {2, 4}, {3, 9}, {4, 16}, {5, 25}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.max_elements(0, 2);
+  printer.print(foo);
+
+  const std::string expected = "{... (5 more)}\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print priority queue with head and tail (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::vector<int> values {5, 1, 8, 3, 9, 2, 7};
+  std::priority_queue<int> foo(values.begin(), values.end());
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.max_elements(2, 1);
+  printer.print(foo);
+
+  const std::string expected = "[9, 8, ... (4 more), 1]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print nested vector with max depth (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::vector<std::vector<int>> foo {{1, 2}, {3}, {}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.max_depth(1);
+  printer.print(foo);
+
+  const std::string expected = "[[... (2 more)], [... (1 more)], []]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print string with max string length (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::vector<std::string> foo {"pretty", "printer"};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.quotes(true);
+  printer.max_string_length(6);
+  printer.print(foo);
+  printer.max_string_length(2);
+  printer.print("\xc3\xa9t\xc3\xa9");
+
+  const std::string expected = "[\"pretty\", \"printe... (1 more)\"]\n\"\xc3\xa9... (3 more)\"\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print vector within byte budget (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::vector<int> foo(1000);
+  for (size_t i = 0; i < foo.size(); i++)
+    foo[i] = static_cast<int>(i);
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.max_bytes(20);
+  printer.print(foo);
+
+  const std::string expected = "[\n  0, \n  1, \n  2, \n  3, \n  ...\n]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print nested containers within byte budget (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::map<std::string, std::vector<std::string>> foo {{"a", {"b", "c", "d"}}, {"e", {"f"}}, {"g", {}}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.compact(true);
+  printer.quotes(true);
+  printer.max_bytes(16);
+  printer.print(foo);
+  printer.print(foo);
+
+  const std::string expected = "{\"a\" : [\"b\", \"c\", ...]}\n";
+
+  REQUIRE(stream.str() == expected + expected);
+}
+
+TEST_CASE("Print string within byte budget (line_terminator = '\n', indent = 2)",
+	  "[truncation]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.max_bytes(8);
+  printer.print(std::string(100, 'x'), 1, 2);
+
+  const std::string expected = "xxxxxxxx...\n";
+
+  REQUIRE(stream.str() == expected);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+TEST_CASE("Print tuple (line_terminator = '\n', indent = 2)",
+	  "[tuple]") {
+  std::tuple<int, char, std::string> foo {1, 'A', "Lisa"};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(foo);
+
+  const std::string expected = "(1, A, Lisa)\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print tuple with quotes (line_terminator = '\n', indent = 2)",
+	  "[tuple]") {
+  std::tuple<int, char, const char *, std::string> foo {1, 'A', "Lisa", "Simpson"};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.quotes(true);
+  printer.print(foo);
+
+  const std::string expected = "(1, 'A', \"Lisa\", \"Simpson\")\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print empty tuple (line_terminator = '\n', indent = 2)",
+	  "[tuple]") {
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(std::tuple<>());
+
+  const std::string expected = "()\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print tuple of containers (line_terminator = '\n', indent = 2)",
+	  "[tuple]") {
+  std::tuple<std::vector<int>, std::map<int, int>> foo {{1, 2, 3}, {{4, 5}}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(foo);
+
+  const std::string expected = "([1, 2, 3], {4 : 5})\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Print vector of tuples (line_terminator = '\n', indent = 2)",
+	  "[tuple]") {
+  std::vector<std::tuple<int, std::vector<int>>> foo {{1, {2, 3}}, {4, {5, 6}}};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(foo);
+
+  const std::string expected = "[\n  (1, [2, 3]), \n  (4, [5, 6])\n]\n";
+
+  REQUIRE(stream.str() == expected);
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <catch.hpp>
+#include <pprint.hpp>
+
+TEST_CASE("Type name cache returns stable names (line_terminator = '\n', indent = 2)",
+	  "[type_name]") {
+  auto& cache = pprint::detail::type_name_cache::instance();
+  const std::string_view first = cache.lookup(typeid(std::vector<int>));
+  const std::string_view second = cache.lookup(typeid(std::vector<int>));
+
+  REQUIRE(first == pprint::detail::demangle(typeid(std::vector<int>).name()));
+  REQUIRE(first.data() == second.data());
+  REQUIRE(cache.lookup(typeid(int)) == "int");
+}
+
+TEST_CASE("Print smart pointer type (line_terminator = '\n', indent = 2)",
+	  "[type_name]") {
+  auto foo = std::make_shared<int>(5);
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(foo);
+  printer.print(foo);
+
+  std::stringstream address;
+  address << &foo;
+  const std::string line = "<std::shared_ptr<int> at " + address.str() + ">\n";
+
+  REQUIRE(stream.str() == line + line);
+}
+
+TEST_CASE("Type names are known at compile time (line_terminator = '\n', indent = 2)",
+	  "[type_name]") {
+  static_assert(pprint::detail::type_name_v<int> == "int");
+  static_assert(pprint::detail::type_name_v<std::pair<int, double>> == "std::pair<int, double>");
+  REQUIRE(pprint::detail::type_name_v<const char *> == "const char*");
+}
+
+struct TypeNameBase {
+  virtual ~TypeNameBase() = default;
+};
+
+struct TypeNameDerived : TypeNameBase {};
+
+TEST_CASE("Print object type (line_terminator = '\n', indent = 2)",
+	  "[type_name]") {
+  TypeNameDerived foo;
+  const TypeNameBase& bar = foo;
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(bar);
+
+#if PPRINT_RTTI
+  const std::string expected = "<Object TypeNameDerived>\n";
+#else
+  const std::string expected = "<Object TypeNameBase>\n";
+#endif
+
+  REQUIRE(stream.str() == expected);
+}
+
+TEST_CASE("Type names use standard aliases (line_terminator = '\n', indent = 2)",
+	  "[type_name]") {
+  static_assert(pprint::detail::type_name_v<std::string> == "std::string");
+  static_assert(pprint::detail::type_name_v<std::map<std::string, std::vector<int>>> ==
+		"std::map<std::string, std::vector<int>>");
+  REQUIRE(pprint::detail::type_name_v<std::unique_ptr<int>> == "std::unique_ptr<int>");
+  REQUIRE(pprint::detail::type_name_v<std::set<int, std::greater<int>>> == "std::set<int, std::greater<int>>");
+
+  const std::string_view demangled =
+    "std::__cxx11::basic_string<char, std::char_traits<char>, std::allocator<char> >";
+  std::string shortened(demangled);
+  shortened.resize(pprint::detail::shorten_type_name(shortened, shortened.data()));
+  REQUIRE(shortened == "std::string");
+
+  const std::string_view nested =
+    "std::shared_ptr<std::vector<std::vector<int, std::allocator<int> >, "
+    "std::allocator<std::vector<int, std::allocator<int> > > > >";
+  shortened = nested;
+  shortened.resize(pprint::detail::shorten_type_name(shortened, shortened.data()));
+  REQUIRE(shortened == "std::shared_ptr<std::vector<std::vector<int>>>");
+}
+
+// Allocator that isn't std::allocator, so it is no default
+template <typename T>
+struct TypeNameAllocator : std::allocator<T> {
+  template <typename U>
+  struct rebind {
+    typedef TypeNameAllocator<U> other;
+  };
+};
+
+TEST_CASE("Type names keep template arguments that are not defaults (line_terminator = '\n', indent = 2)",
+	  "[type_name]") {
+  static_assert(pprint::detail::type_name_v<std::pair<int, std::hash<int>>> == "std::pair<int, std::hash<int>>");
+  static_assert(pprint::detail::type_name_v<std::set<int, std::less<void>>> == "std::set<int, std::less<void>>");
+  static_assert(pprint::detail::type_name_v<std::vector<std::less<int>>> == "std::vector<std::less<int>>");
+  static_assert(pprint::detail::type_name_v<std::set<char, std::less<int>>> == "std::set<char, std::less<int>>");
+  static_assert(pprint::detail::type_name_v<std::map<int, int, std::less<>>> == "std::map<int, int, std::less<void>>");
+  // A default before an argument that is kept stays too
+  static_assert(pprint::detail::type_name_v<std::set<int, std::less<int>, TypeNameAllocator<int>>> ==
+		"std::set<int, std::less<int>, TypeNameAllocator<int>>");
+  static_assert(pprint::detail::type_name_v<std::unordered_map<std::string, int>> ==
+		"std::unordered_map<std::string, int>");
+  static_assert(pprint::detail::type_name_v<std::multimap<const char *, int>> == "std::multimap<const char*, int>");
+
+  const std::string_view demangled =
+    "std::map<int, double, std::greater<int>, std::allocator<std::pair<int const, double> > >";
+  std::string shortened(demangled);
+  shortened.resize(pprint::detail::shorten_type_name(shortened, shortened.data()));
+  REQUIRE(shortened == "std::map<int, double, std::greater<int>>");
+
+  // Commas outside template arguments are left alone
+  shortened = "void (*)(std::vector<int, std::allocator<int> >, int)";
+  shortened.resize(pprint::detail::shorten_type_name(shortened, shortened.data()));
+  REQUIRE(shortened == "void (*)(std::vector<int>, int)");
+}
+
+template <int N>
+struct TypeNameFiller {
+  virtual ~TypeNameFiller() = default;
+};
+
+struct TypeNameOverflow {
+  virtual ~TypeNameOverflow() = default;
+};
+
+template <int... N>
+void fill_type_name_cache(std::integer_sequence<int, N...>) {
+  const std::type_info * types[] = {&typeid(TypeNameFiller<N>)...};
+  for (const std::type_info * type : types)
+    pprint::detail::type_name_cache::instance().lookup(*type);
+}
+
+TEST_CASE("Print object type once the type name cache is full (line_terminator = '\n', indent = 2)",
+	  "[type_name]") {
+  auto& cache = pprint::detail::type_name_cache::instance();
+  REQUIRE(cache.lookup(typeid(int)) == "int");
+  fill_type_name_cache(std::make_integer_sequence<int, pprint::detail::type_name_cache::capacity>());
+
+  REQUIRE(cache.lookup(typeid(TypeNameOverflow)).empty());
+  REQUIRE(cache.lookup(typeid(int)) == "int");
+
+  TypeNameOverflow foo;
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print(foo, foo);
+  printer.print(std::make_pair(std::cref(foo), 1));
+
+  const std::string expected = "<Object TypeNameOverflow> <Object TypeNameOverflow>\n"
+    "(<Object TypeNameOverflow>, 1)\n";
+
+  REQUIRE(stream.str() == expected);
+}
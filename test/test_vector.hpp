@@ -93,6 +93,23 @@ TEST_CASE("Print nested vector (line_terminator = '\n', indent = 2)",
   REQUIRE(stream.str() == expected);
 }
 
+TEST_CASE("Print nested vector inline (line_terminator = '\n', indent = 2)",
+	  "[std::vector]") {
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.print_inline(std::vector<std::vector<int>>{{1, 2}, {3}});
+
+  // The closing bracket goes on a line of its own, at the indentation of
+  // the call, with no trailing spaces before it
+  const std::string expected = "[\n"
+    "    [1, 2], \n"
+    "    [3]"
+    "\n  ]\n";
+
+  REQUIRE(stream.str() == expected);
+}
+
 TEST_CASE("Compact Print nested vector (line_terminator = '\n', indent = 2)",
 	  "[std::vector]") {
 
@@ -134,3 +151,21 @@ TEST_CASE("Print another nested matrix (line_terminator = '\n', indent = 2)",
 
   REQUIRE(stream.str() == expected);
 }
+
+TEST_CASE("Print vector of strings (line_terminator = '\n', indent = 2)",
+	  "[std::vector]") {
+  std::vector<std::string> foo {"a", "b", "c"};
+
+  std::stringstream stream;
+  pprint::PrettyPrinter printer(stream);
+  printer.quotes(true);
+  printer.print(foo);
+
+  const std::string expected = "[\n"
+    "  \"a\", \n"
+    "  \"b\", \n"
+    "  \"c\""
+    "\n]\n";
+
+  REQUIRE(stream.str() == expected);
+}
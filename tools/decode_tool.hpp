@@ -0,0 +1,74 @@
+#pragma once
+// Command line shared by the tools that print a file format in the text
+// format of pprint::PrettyPrinter::print:
+//
+//   <tool> [--compact] [--quotes] [--indent N] [--max-elements N] <file>...
+//
+// Standard input is read when no file is given, or for "-"
+
+#include <pprint.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace pprint_tools {
+
+  // Configures a printer from the options in argv and prints each file
+  // with `print(in, printer)`, which returns false on malformed input.
+  // `input` names the files in the usage message and `format` the format
+  // in error messages. Returns the exit status of the tool
+  template <typename Print>
+  int run_decode_tool(int argc, char * argv[], const std::string& tool, const std::string& input,
+		      const std::string& format, Print print) {
+    std::ios_base::sync_with_stdio(false);
+    pprint::PrettyPrinter printer(std::cout);
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+      const std::string argument = argv[i];
+      if (argument == "--compact")
+	printer.compact(true);
+      else if (argument == "--quotes")
+	printer.quotes(true);
+      else if (argument == "--indent" && i + 1 < argc)
+	printer.indent(std::strtoul(argv[++i], nullptr, 10));
+      else if (argument == "--max-elements" && i + 1 < argc)
+	printer.max_elements(std::strtoul(argv[++i], nullptr, 10));
+      else if (!argument.empty() && argument[0] == '-' && argument != "-") {
+	std::cerr << "usage: " << tool << " [--compact] [--quotes] [--indent N] [--max-elements N] <"
+		  << input << ">...\n";
+	return 2;
+      }
+      else
+	files.push_back(argument);
+    }
+
+    auto decode = [&](std::istream& in, const std::string& name) {
+      if (print(in, printer))
+	return true;
+      std::cout.flush();
+      std::cerr << tool << ": " << name << ": malformed " << format << "\n";
+      return false;
+    };
+
+    if (files.empty())
+      files.push_back("-");
+    bool ok = true;
+    for (const std::string& file : files) {
+      if (file == "-") {
+	ok = decode(std::cin, "<stdin>") && ok;
+	continue;
+      }
+      std::ifstream in(file, std::ios_base::binary);
+      if (!in) {
+	std::cerr << tool << ": cannot open " << file << "\n";
+	ok = false;
+	continue;
+      }
+      ok = decode(in, file) && ok;
+    }
+    return ok ? 0 : 1;
+  }
+
+}
@@ -0,0 +1,15 @@
+// Prints CBOR sequences, such as those written by pprint::CborPrinter, in
+// the text format of pprint::PrettyPrinter::print
+//
+//   pprint_cbor [--compact] [--quotes] [--indent N] [--max-elements N] <file>...
+//
+// Reads standard input when no file is given
+
+#include "decode_tool.hpp"
+
+int main(int argc, char * argv[]) {
+  return pprint_tools::run_decode_tool(argc, argv, "pprint_cbor", "file", "CBOR",
+				       [](std::istream& in, const pprint::PrettyPrinter& printer) {
+					 return pprint::print_cbor(in, printer);
+				       });
+}
@@ -0,0 +1,15 @@
+// Prints binary logs written by pprint::BinaryLogger::write or a
+// pprint::RecordStream in the text format of pprint::PrettyPrinter::print
+//
+//   pprint_decode [--compact] [--quotes] [--indent N] [--max-elements N] <log>...
+//
+// Reads standard input when no log file is given
+
+#include "decode_tool.hpp"
+
+int main(int argc, char * argv[]) {
+  return pprint_tools::run_decode_tool(argc, argv, "pprint_decode", "log", "binary log",
+				       [](std::istream& log, const pprint::PrettyPrinter& printer) {
+					 return pprint::print_binary_log(log, printer);
+				       });
+}